@@ -0,0 +1,205 @@
+//
+//  teletype-bench: characters-per-second benchmark over a set of print
+//  corpora.  Each corpus is sent through the firmware in a fresh child
+//  process (the firmware's state is all static, so this is the simplest way
+//  to start from power-up every time), and the child reports back where the
+//  simulated time went.
+//
+//  Usage: teletype-bench [-o NAME=VALUE]... CORPUS...
+//
+//    -o  set a typewriter model option, as for teletype-host
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "typewriter.h"
+
+#define START_TIME  (HOST_CYCLES_PER_SEC / 10)
+#define QUIET_TIME  (3 * HOST_CYCLES_PER_SEC)
+
+typedef struct
+{
+    uint32_t    cBytes;
+    uint32_t    cPrinted;       // characters and spaces on paper
+    uint32_t    cKeystrokes;
+    uint32_t    cErrors;        // short presses, bounces and lost keys
+    uint32_t    cOverruns;
+    host_time_t tElapsed;
+    host_time_t atWaits[PROFILE_MAX];
+} bench_result_t;
+
+static int g_fdResult = -1;
+
+static void bench_step(void)
+{
+    host_time_t tLast = typewriter_last_activity();
+
+    if (host_uart_backlog() != 0 || host_now() - tLast <= QUIET_TIME)
+        return;
+
+    const typewriter_stats_t *pStats = typewriter_stats();
+    bench_result_t            result = { 0 };
+
+    result.cBytes      = host_uart_received();
+    result.cPrinted    = pStats->cPrinted + pStats->cSpaces;
+    result.cKeystrokes = pStats->cKeystrokes;
+    result.cErrors     = pStats->cShort + pStats->cBounces + pStats->cLost;
+    result.cOverruns   = host_uart_overruns();
+    result.tElapsed    = (tLast > START_TIME) ? tLast - START_TIME : 0;
+
+    for (int nWait = 0; nWait < PROFILE_MAX; nWait++)
+        result.atWaits[nWait] = host_profile_time(nWait);
+
+    if (write(g_fdResult, &result, sizeof(result)) != sizeof(result))
+        _exit(1);
+
+    _exit(0);
+}
+
+static void bench_transmitted(char ch)
+{
+    (void) ch;  // keyboard echo isn't interesting here
+}
+
+static int bench_child(const char *pszCorpus)
+{
+    FILE  *pf = fopen(pszCorpus, "rb");
+    char   ach[4096];
+    size_t cch;
+
+    if (pf == NULL)
+    {
+        perror(pszCorpus);
+        return 1;
+    }
+
+    while ((cch = fread(ach, 1, sizeof(ach), pf)) > 0)
+        host_uart_send(ach, cch);
+
+    fclose(pf);
+
+    host_hooks.pfnTransmitted = bench_transmitted;
+    host_hooks.pfnStep        = bench_step;
+
+    host_init();
+    host_uart_start_at(START_TIME);
+
+    char *argv[] = { "teletype", NULL };
+    return firmware_main(1, argv);
+}
+
+static bit bench_run(const char *pszCorpus, bench_result_t *pResult)
+{
+    int   afd[2];
+    pid_t pid;
+    int   nStatus;
+
+    fflush(stdout);
+
+    if (pipe(afd) < 0 || (pid = fork()) < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0)
+    {
+        close(afd[0]);
+        g_fdResult = afd[1];
+        _exit(bench_child(pszCorpus));
+    }
+
+    close(afd[1]);
+
+    ssize_t cb = read(afd[0], pResult, sizeof(*pResult));
+
+    close(afd[0]);
+    waitpid(pid, &nStatus, 0);
+
+    return cb == sizeof(*pResult);
+}
+
+static double seconds(host_time_t t)
+{
+    return (double) t / HOST_CYCLES_PER_SEC;
+}
+
+static void bench_print(const char *pszName, const bench_result_t *pResult)
+{
+    double sElapsed = seconds(pResult->tElapsed);
+
+    printf("%-16s %7u %9.1f %8.2f %8.2f %9.1f %8.1f %8.1f %8.1f %6u\n",
+           pszName,
+           pResult->cBytes,
+           sElapsed,
+           sElapsed > 0 ? pResult->cBytes / sElapsed : 0.0,
+           pResult->cPrinted ? (double) pResult->cKeystrokes
+                               / pResult->cPrinted : 0.0,
+           seconds(pResult->atWaits[PROFILE_RETURN]),
+           seconds(pResult->atWaits[PROFILE_GAP]),
+           seconds(pResult->atWaits[PROFILE_SCAN_SYNC]),
+           seconds(pResult->atWaits[PROFILE_KEYSTROKE]),
+           pResult->cErrors + pResult->cOverruns);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_result_t total = { 0 };
+    int            nOpt;
+
+    while ((nOpt = getopt(argc, argv, "o:")) != -1)
+    {
+        char *pszValue;
+
+        if (nOpt == 'o' && (pszValue = strchr(optarg, '=')) != NULL)
+        {
+            *pszValue++ = '\0';
+
+            if (typewriter_set_option(optarg, atof(pszValue)))
+                continue;
+        }
+
+        fprintf(stderr, "usage: %s [-o NAME=VALUE]... CORPUS...\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-16s %7s %9s %8s %8s %9s %8s %8s %8s %6s\n",
+           "corpus", "bytes", "time s", "chars/s", "keys/ch",
+           "return s", "gap s", "sync s", "held s", "errors");
+
+    for (int idx = optind; idx < argc; idx++)
+    {
+        bench_result_t result;
+        char           szName[256];
+
+        snprintf(szName, sizeof(szName), "%s", argv[idx]);
+
+        if (! bench_run(argv[idx], &result))
+        {
+            fprintf(stderr, "%s: benchmark run failed\n", argv[idx]);
+            return 1;
+        }
+
+        bench_print(basename(szName), &result);
+
+        total.cBytes      += result.cBytes;
+        total.cPrinted    += result.cPrinted;
+        total.cKeystrokes += result.cKeystrokes;
+        total.cErrors     += result.cErrors;
+        total.cOverruns   += result.cOverruns;
+        total.tElapsed    += result.tElapsed;
+
+        for (int nWait = 0; nWait < PROFILE_MAX; nWait++)
+            total.atWaits[nWait] += result.atWaits[nWait];
+    }
+
+    if (argc - optind > 1)
+        bench_print("TOTAL", &total);
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * File:   host.h
+ *
+ * Interface to the emulated PIC16F1519 for the host-side tools; the firmware
+ * itself only ever sees xc.h.
+ */
+
+#ifndef HOST_H
+#define	HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <xc.h>
+#include "timers.h"
+#include "profile.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    //
+    //  Simulated time is counted in instruction cycles since reset.
+    //
+    typedef uint64_t host_time_t;
+
+#define HOST_NEVER          UINT64_MAX
+#define HOST_CYCLES_PER_SEC (_XTAL_FREQ / 4)
+#define HOST_CYCLES_PER_MS  (HOST_CYCLES_PER_SEC / 1000)
+#define HOST_CYCLES_PER_US  (HOST_CYCLES_PER_SEC / 1000000.0)
+
+    extern host_time_t host_now(void);
+    extern void        host_init(void);
+
+    //
+    //  Callbacks from the emulation into whichever tool is driving it.
+    //
+    typedef struct
+    {
+        void (*pfnTransmitted)(char ch);    // PIC sent a byte to the host
+        void (*pfnStep)(void);              // simulated time moved on
+    } host_hooks_t;
+
+    extern host_hooks_t host_hooks;
+
+    //
+    //  The host end of the serial line.
+    //
+    extern void     host_uart_send(const char *pch, size_t cch);
+    extern void     host_uart_start_at(host_time_t t);
+    extern size_t   host_uart_backlog(void);
+    extern uint32_t host_uart_received(void);
+    extern uint32_t host_uart_overruns(void);
+    extern bit      host_uart_dtr_asserted(void);
+
+    //
+    //  Emulation statistics
+    //
+    extern uint32_t    host_isr_count(void);
+    extern host_time_t host_isr_cycles(void);
+
+    extern void        host_profile_advance(host_time_t cCycles);
+    extern host_time_t host_profile_time(profile_wait_t nWait);
+
+    //
+    //  The firmware's own entry points; main() is renamed when building for
+    //  the host so the tools can provide their own.
+    //
+    extern int  firmware_main(int argc, char *argv[]);
+    extern void fast_isr(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HOST_H */
@@ -0,0 +1,154 @@
+//
+//  teletype-host: runs the firmware on the emulated PIC, feeding it a file
+//  (or stdin) over the serial line and copying whatever it sends back to
+//  stdout.  The run ends once everything has been sent and the typewriter
+//  has been left alone for a while.
+//
+//  Usage: teletype-host [-q SECONDS] [-k] [-p PAPER] [-o NAME=VALUE]... [FILE]
+//
+//    -q  seconds of inactivity that end the run (default 3)
+//    -k  log every key the typewriter sees, with its scan count, to stderr
+//    -p  write what ended up on the paper to the file PAPER
+//    -o  set a typewriter model option, e.g. scan_ms=8 or debounce=3
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "typewriter.h"
+
+static host_time_t g_tQuiet      = 3 * HOST_CYCLES_PER_SEC;
+static const char *g_pszPaper    = NULL;
+
+static void host_main_transmitted(char ch)
+{
+    putc(ch, stdout);
+}
+
+static void host_main_report(void)
+{
+    double sElapsed = (double) host_now() / HOST_CYCLES_PER_SEC;
+
+    fflush(stdout);
+    fprintf(stderr,
+            "simulated time  %10.3f s\n"
+            "bytes received  %10u\n"
+            "rx overruns     %10u\n"
+            "interrupts      %10u (%.1f%% of cycles)\n",
+            sElapsed,
+            host_uart_received(),
+            host_uart_overruns(),
+            host_isr_count(),
+            host_now() ? 100.0 * host_isr_cycles() / host_now() : 0.0);
+
+    typewriter_report(stderr);
+
+    if (g_pszPaper)
+    {
+        FILE *pf = fopen(g_pszPaper, "w");
+
+        if (pf == NULL)
+        {
+            perror(g_pszPaper);
+            return;
+        }
+
+        typewriter_dump_paper(pf);
+        fclose(pf);
+    }
+}
+
+static void host_main_step(void)
+{
+    host_time_t tLast = typewriter_last_activity();
+
+    if (host_uart_backlog() == 0 && host_now() - tLast > g_tQuiet)
+    {
+        host_main_report();
+        exit(0);
+    }
+}
+
+static bit host_main_option(char *pszOption)
+{
+    char *pszValue = strchr(pszOption, '=');
+
+    if (pszValue == NULL)
+        return 0;
+
+    *pszValue++ = '\0';
+    return typewriter_set_option(pszOption, atof(pszValue));
+}
+
+static void host_main_load(FILE *pf)
+{
+    char   ach[4096];
+    size_t cch;
+
+    while ((cch = fread(ach, 1, sizeof(ach), pf)) > 0)
+    {
+        host_uart_send(ach, cch);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+
+    while ((nOpt = getopt(argc, argv, "q:kp:o:")) != -1)
+    {
+        switch (nOpt)
+        {
+            case 'q':
+                g_tQuiet = atof(optarg) * HOST_CYCLES_PER_SEC;
+                break;
+
+            case 'k':
+                typewriter_set_log(stderr);
+                break;
+
+            case 'p':
+                g_pszPaper = optarg;
+                break;
+
+            case 'o':
+                if (host_main_option(optarg))
+                    break;
+
+                fprintf(stderr, "%s: bad option '%s'\n", argv[0], optarg);
+                return 2;
+
+            default:
+                fprintf(stderr, "usage: %s [-q SECONDS] [-k] [-p PAPER] "
+                                "[-o NAME=VALUE]... [FILE]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind < argc)
+    {
+        FILE *pf = fopen(argv[optind], "rb");
+
+        if (pf == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+
+        host_main_load(pf);
+        fclose(pf);
+    }
+    else
+    {
+        host_main_load(stdin);
+    }
+
+    host_hooks.pfnTransmitted = host_main_transmitted;
+    host_hooks.pfnStep        = host_main_step;
+
+    host_init();
+    host_uart_start_at(HOST_CYCLES_PER_SEC / 10);  // once we're up and running
+    return firmware_main(argc, argv);
+}
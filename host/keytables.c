@@ -0,0 +1,253 @@
+//
+//  keytables: generates keytables.h, the reverse lookups of the tables in
+//  keymap.h, so the firmware can keep them in flash rather than building them
+//  in RAM at power-up.  Mapping conflicts fail the build: a key that appears
+//  twice in the matrix, a character whose key isn't in the matrix at all, two
+//  characters on one key when neither is listed as a substitute, or a key
+//  listed in more than one class.
+//
+//  Usage: keytables > keytables.h
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "xc.h"
+#include "keyboard.h"
+#include "keymap.h"
+
+static const keyid_t g_aKeyIDs[]       = KEYMAP_SCAN_IDS;
+static const keyid_t g_aAsciiKeys[128] = KEYMAP_ASCII_KEYS;
+static const keyid_t g_aEscapeKeys[]    = KEYMAP_ESCAPE_KEYS;
+static const keyid_t g_aFeedKeys[]      = KEYMAP_FEED_KEYS;
+static const keyid_t g_aFunctionKeys[]  = KEYMAP_FUNCTION_KEYS;
+
+typedef struct
+{
+    uint8_t row;
+    uint8_t columns[2];
+} keyscan_t;
+
+static keyscan_t g_aKeyScans[KEY_MAX];
+static int       g_anScanPositions[KEY_MAX];
+static int       g_achKeys[KEY_MAX | KEY_SHIFTED];
+static int       g_anClasses[KEY_MAX];
+static int       g_abClassed[KEY_MAX];
+
+static int g_cErrors = 0;
+
+static void keytables_error(const char *pszFormat, ...)
+{
+    va_list args;
+
+    va_start(args, pszFormat);
+    fprintf(stderr, "keymap.h: ");
+    vfprintf(stderr, pszFormat, args);
+    fputc('\n', stderr);
+    va_end(args);
+    g_cErrors++;
+}
+
+static void keytables_build_scans(void)
+{
+    for (int nKey = 0; nKey < KEY_MAX; nKey++)
+    {
+        g_aKeyScans[nKey].row        = 0xff;
+        g_aKeyScans[nKey].columns[0] = 0xff;
+        g_aKeyScans[nKey].columns[1] = 0x3e;
+        g_anScanPositions[nKey]      = -1;
+    }
+
+    if (sizeof(g_aKeyIDs) != 8 * 13 * sizeof(keyid_t))
+        keytables_error("the scan table has %d entries, not %d",
+                        (int) (sizeof(g_aKeyIDs) / sizeof(keyid_t)), 8 * 13);
+
+    for (int nPosition = 0; nPosition < 8 * 13; nPosition++)
+    {
+        int nKey    = g_aKeyIDs[nPosition];
+        int nRow    = nPosition / 13;
+        int nColumn = nPosition % 13;
+
+        if (nKey == KEY_NONE || nKey == KEY_UNKNOWN)
+            continue;
+
+        if (nKey >= KEY_MAX)
+        {
+            keytables_error("key %d at row %d column %d is out of range",
+                            nKey, nRow, nColumn);
+            continue;
+        }
+
+        if (g_anScanPositions[nKey] >= 0)
+        {
+            keytables_error("key %d is at both position %d and position %d",
+                            nKey, g_anScanPositions[nKey], nPosition);
+            continue;
+        }
+
+        g_anScanPositions[nKey] = nPosition;
+        g_aKeyScans[nKey].row  &= ~(1 << nRow);
+
+        if (nColumn < 8)
+            g_aKeyScans[nKey].columns[0] &= ~(1 << nColumn);
+        else
+            g_aKeyScans[nKey].columns[1] &= ~(1 << (nColumn - 7));
+    }
+}
+
+static void keytables_build_chars(void)
+{
+    //
+    //  Two passes, so a character's own key is claimed before anything that
+    //  substitutes for it, wherever they come in the table.
+    //
+    for (int nPass = 0; nPass < 2; nPass++)
+    {
+        for (int ch = 0; ch < 128; ch++)
+        {
+            int nKey        = g_aAsciiKeys[ch];
+            int bSubstitute = ch != 0
+                           && strchr(KEYMAP_ASCII_SUBSTITUTES, ch) != NULL;
+
+            if (nKey == KEY_NONE || bSubstitute != nPass)
+                continue;
+
+            if ((nKey & ~KEY_SHIFTED) >= KEY_MAX
+                || g_anScanPositions[nKey & ~KEY_SHIFTED] < 0)
+            {
+                keytables_error("character 0x%02x wants key %d, which isn't "
+                                "in the scan table", ch, nKey);
+                continue;
+            }
+
+            if (g_achKeys[nKey] == 0)
+                g_achKeys[nKey] = ch;
+            else if (! bSubstitute)
+                keytables_error("characters 0x%02x and 0x%02x both claim "
+                                "key 0x%02x", g_achKeys[nKey], ch, nKey);
+        }
+    }
+}
+
+static void keytables_class_keys(const keyid_t *pKeys, int cKeys, int nClass)
+{
+    for (int idx = 0; idx < cKeys; idx++)
+    {
+        int nKey = pKeys[idx];
+
+        if (nKey >= KEY_MAX || g_anScanPositions[nKey] < 0)
+        {
+            keytables_error("class %d wants key %d, which isn't in the scan "
+                            "table", nClass, nKey);
+            continue;
+        }
+
+        if (g_abClassed[nKey])
+        {
+            keytables_error("key %d is in both class %d and class %d",
+                            nKey, g_anClasses[nKey], nClass);
+            continue;
+        }
+
+        g_anClasses[nKey] = nClass;
+        g_abClassed[nKey] = 1;
+    }
+}
+
+#define COUNTOF(a)  ((int) (sizeof(a) / sizeof((a)[0])))
+
+static void keytables_build_classes(void)
+{
+    keytables_class_keys(g_aEscapeKeys,   COUNTOF(g_aEscapeKeys),
+                         KEYCLASS_ESCAPE);
+    keytables_class_keys(g_aFeedKeys,     COUNTOF(g_aFeedKeys),
+                         KEYCLASS_FEED);
+    keytables_class_keys(g_aFunctionKeys, COUNTOF(g_aFunctionKeys),
+                         KEYCLASS_FUNCTION);
+}
+
+static void keytables_print(void)
+{
+    printf("/*\n"
+           " * File:   keytables.h\n"
+           " *\n"
+           " * Generated from keymap.h by host/keytables.c; do not edit.\n"
+           " */\n"
+           "\n"
+           "#ifndef KEYTABLES_H\n"
+           "#define\tKEYTABLES_H\n"
+           "\n"
+           "//\n"
+           "//  Strobe row and column pins (active low) for each key ID.\n"
+           "//\n"
+           "#define KEYTABLE_SCANS {%40s\\\n", "");
+
+    for (int nKey = 0; nKey < KEY_MAX; nKey++)
+    {
+        printf("    /* %3d */ { 0x%02x, { 0x%02x, 0x%02x } },%24s\\\n", nKey,
+               g_aKeyScans[nKey].row,
+               g_aKeyScans[nKey].columns[0],
+               g_aKeyScans[nKey].columns[1], "");
+    }
+
+    printf("}\n"
+           "\n"
+           "//\n"
+           "//  The character each key types, unshifted and then shifted.\n"
+           "//\n"
+           "#define KEYTABLE_CHARS {%40s\\\n", "");
+
+    for (int nKey = 0; nKey < (KEY_MAX | KEY_SHIFTED); nKey += 8)
+    {
+        printf("    /* %3d */", nKey);
+
+        for (int idx = nKey; idx < nKey + 8; idx++)
+        {
+            if (idx < (KEY_MAX | KEY_SHIFTED))
+                printf(" 0x%02x,", g_achKeys[idx]);
+            else
+                printf("      ");
+        }
+
+        printf("%3s\\\n", "");
+    }
+
+    printf("}\n"
+           "\n"
+           "//\n"
+           "//  The class of each key (see keyclass_t).\n"
+           "//\n"
+           "#define KEYTABLE_CLASSES {%38s\\\n", "");
+
+    for (int nKey = 0; nKey < KEY_MAX; nKey += 16)
+    {
+        printf("    /* %3d */", nKey);
+
+        for (int idx = nKey; idx < nKey + 16; idx++)
+        {
+            if (idx < KEY_MAX)
+                printf(" %d,", g_anClasses[idx]);
+            else
+                printf("   ");
+        }
+
+        printf("%3s\\\n", "");
+    }
+
+    printf("}\n"
+           "\n"
+           "#endif\t/* KEYTABLES_H */\n");
+}
+
+int main(void)
+{
+    keytables_build_scans();
+    keytables_build_chars();
+    keytables_build_classes();
+
+    if (g_cErrors)
+        return 1;
+
+    keytables_print();
+    return 0;
+}
@@ -0,0 +1,602 @@
+//
+//  Emulated PIC16F1519 for the host build.
+//
+//  Only the peripherals the firmware actually uses are modelled: Timer0, the
+//  EUSART, interrupt-on-change on PORTB, the port pins themselves and flash
+//  self-programming (of the High-Endurance Flash, anyway).  Time
+//  is event-driven rather than instruction-accurate; it only moves on when the
+//  firmware spins (timers_idle() and the __delay_ms() stand-in), and then it
+//  jumps straight to the next peripheral event.  Interrupts are taken at those
+//  points and each one is charged a fixed cost, so the main-loop work between
+//  them is treated as free.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <xc.h>
+#include "host.h"
+#include "typewriter.h"
+
+#define HOST_ISR_CYCLES 40      // charged for each pass through fast_isr()
+
+//
+//  The register file itself.
+//
+#define HOST_SFR_DEFINE(name)   volatile host_sfr_t host_##name
+
+HOST_SFR_DEFINE(INTCON);
+HOST_SFR_DEFINE(OPTION_REG);
+HOST_SFR_DEFINE(PIR1);
+HOST_SFR_DEFINE(PIE1);
+HOST_SFR_DEFINE(TMR0);
+HOST_SFR_DEFINE(TMR1L);
+HOST_SFR_DEFINE(TMR1H);
+HOST_SFR_DEFINE(T1CON);
+HOST_SFR_DEFINE(LATA);
+HOST_SFR_DEFINE(LATB);
+HOST_SFR_DEFINE(LATC);
+HOST_SFR_DEFINE(LATD);
+HOST_SFR_DEFINE(LATE);
+HOST_SFR_DEFINE(TRISA);
+HOST_SFR_DEFINE(TRISB);
+HOST_SFR_DEFINE(TRISC);
+HOST_SFR_DEFINE(TRISD);
+HOST_SFR_DEFINE(TRISE);
+HOST_SFR_DEFINE(ANSELA);
+HOST_SFR_DEFINE(ANSELB);
+HOST_SFR_DEFINE(ANSELC);
+HOST_SFR_DEFINE(ANSELD);
+HOST_SFR_DEFINE(ANSELE);
+HOST_SFR_DEFINE(WPUB);
+HOST_SFR_DEFINE(IOCBP);
+HOST_SFR_DEFINE(IOCBN);
+HOST_SFR_DEFINE(IOCBF);
+HOST_SFR_DEFINE(RCSTA);
+HOST_SFR_DEFINE(TXSTA);
+HOST_SFR_DEFINE(BAUDCON);
+HOST_SFR_DEFINE(SPBRGL);
+HOST_SFR_DEFINE(SPBRGH);
+HOST_SFR_DEFINE(PMADRL);
+HOST_SFR_DEFINE(PMADRH);
+HOST_SFR_DEFINE(PMDATL);
+HOST_SFR_DEFINE(PMDATH);
+HOST_SFR_DEFINE(PMCON1);
+
+host_hooks_t host_hooks = { NULL, NULL };
+
+static host_time_t g_tNow       = 0;
+static uint32_t    g_cIsrs      = 0;
+static host_time_t g_tIsrCycles = 0;
+
+host_time_t host_now(void)
+{
+    return g_tNow;
+}
+
+uint32_t host_isr_count(void)
+{
+    return g_cIsrs;
+}
+
+host_time_t host_isr_cycles(void)
+{
+    return g_tIsrCycles;
+}
+
+//
+//  Timer0: counts instruction cycles through the prescaler, raising TMR0IF
+//  on overflow.  The count is brought up to date lazily, whenever simulated
+//  time moves on.
+//
+static host_time_t g_tTimer0    = 0;
+static uint16_t    g_nPrescaled = 0;
+
+static uint16_t timer0_prescaler(void)
+{
+    return PSA ? 1 : (2 << (OPTION_REG & 0x07));
+}
+
+static void timer0_sync(void)
+{
+    host_time_t cCycles = g_tNow - g_tTimer0;
+    g_tTimer0 = g_tNow;
+
+    if (TMR0CS)
+        return;     // T0CKI input isn't connected to anything
+
+    uint16_t    nPrescaler = timer0_prescaler();
+    host_time_t cCounts    = (g_nPrescaled + cCycles) / nPrescaler;
+
+    g_nPrescaled = (g_nPrescaled + cCycles) % nPrescaler;
+
+    if (TMR0 + cCounts > 0xff)
+        TMR0IF = 1;
+
+    TMR0 = (uint8_t) (TMR0 + cCounts);
+}
+
+static host_time_t timer0_next_event(void)
+{
+    if (TMR0CS)
+        return HOST_NEVER;
+
+    return g_tTimer0 + (256 - TMR0) * (host_time_t) timer0_prescaler()
+                     - g_nPrescaled;
+}
+
+//
+//  Timer1: counts instruction cycles through its prescaler into TMR1H:TMR1L,
+//  raising TMR1IF on overflow; like Timer0, it's updated lazily.  Only the
+//  instruction clock source is modelled.
+//
+static host_time_t g_tTimer1      = 0;
+static uint16_t    g_nT1Prescaled = 0;
+
+static void timer1_sync(void)
+{
+    host_time_t cCycles = g_tNow - g_tTimer1;
+    g_tTimer1 = g_tNow;
+
+    if (! TMR1ON || TMR1CS1 || TMR1CS0)
+        return;
+
+    uint16_t    nPrescaler = 1 << ((T1CON >> 4) & 0x03);
+    host_time_t cCounts    = (g_nT1Prescaled + cCycles) / nPrescaler;
+    uint32_t    nTimer     = ((uint16_t) TMR1H << 8) | TMR1L;
+
+    g_nT1Prescaled = (g_nT1Prescaled + cCycles) % nPrescaler;
+
+    if (nTimer + cCounts > 0xffff)
+        TMR1IF = 1;
+
+    nTimer = (uint16_t) (nTimer + cCounts);
+    TMR1H  = (uint8_t) (nTimer >> 8);
+    TMR1L  = (uint8_t) nTimer;
+}
+
+static host_time_t timer1_next_event(void)
+{
+    if (! TMR1ON || ! TMR1IE || TMR1CS1 || TMR1CS0)
+        return HOST_NEVER;
+
+    uint16_t nPrescaler = 1 << ((T1CON >> 4) & 0x03);
+    uint32_t nTimer     = ((uint16_t) TMR1H << 8) | TMR1L;
+
+    return g_tTimer1 + (0x10000 - nTimer) * (host_time_t) nPrescaler
+                     - g_nT1Prescaled;
+}
+
+//
+//  EUSART: a two-byte receive FIFO fed from the host's send queue, and a
+//  transmit register/shift register pair draining to the host hook.  Flow
+//  control is up to the firmware; the host stops starting new bytes as soon
+//  as DTR is dropped or it's received XOFF, which is kinder than most real
+//  hosts.
+//
+static char       *g_pchSend     = NULL;
+static size_t      g_cchSend     = 0;
+static size_t      g_idxSend     = 0;
+static size_t      g_cchSendMax  = 0;
+static host_time_t g_tSendStart  = 0;
+static host_time_t g_tRxDone     = HOST_NEVER;
+static char        g_chRxShift   = 0;
+static char        g_achRxFifo[2];
+static uint8_t     g_cRxFifo     = 0;
+static uint32_t    g_cReceived   = 0;
+static uint32_t    g_cOverruns   = 0;
+static bit         g_bXoff       = 0;
+
+static volatile uint8_t g_chTxReg;
+static bit         g_bTxRegFull  = 0;
+static char        g_chTxShift   = 0;
+static host_time_t g_tTxDone     = HOST_NEVER;
+
+static host_time_t eusart_cycles_per_byte(void)
+{
+    uint16_t nBrg     = BRG16 ? ((SPBRGH << 8) | SPBRGL) : SPBRGL;
+    uint8_t  nDivisor = BRGH ? (BRG16 ? 1 : 4) : (BRG16 ? 4 : 16);
+
+    return 10 * (host_time_t) nDivisor * (nBrg + 1);
+}
+
+bit host_uart_dtr_asserted(void)
+{
+    //
+    //  The firmware drives DTR active-low through LATA3; an unconfigured
+    //  pin floats and we'll treat that as asserted.
+    //
+    return TRISA3 || ! LATA3;
+}
+
+void host_uart_send(const char *pch, size_t cch)
+{
+    if (g_cchSend + cch > g_cchSendMax)
+    {
+        g_cchSendMax = (g_cchSend + cch) * 2;
+        g_pchSend    = realloc(g_pchSend, g_cchSendMax);
+
+        if (g_pchSend == NULL)
+            abort();
+    }
+
+    memcpy(g_pchSend + g_cchSend, pch, cch);
+    g_cchSend += cch;
+}
+
+void host_uart_start_at(host_time_t t)
+{
+    g_tSendStart = t;
+}
+
+size_t host_uart_backlog(void)
+{
+    return g_cchSend - g_idxSend + (g_tRxDone != HOST_NEVER);
+}
+
+uint32_t host_uart_received(void)
+{
+    return g_cReceived;
+}
+
+uint32_t host_uart_overruns(void)
+{
+    return g_cOverruns;
+}
+
+char host_read_rcreg(void)
+{
+    char ch = g_achRxFifo[0];
+
+    if (g_cRxFifo)
+    {
+        g_achRxFifo[0] = g_achRxFifo[1];
+        g_cRxFifo--;
+    }
+
+    RCIF = (g_cRxFifo > 0);
+    return ch;
+}
+
+volatile uint8_t *host_write_txreg(void)
+{
+    g_bTxRegFull = 1;
+    TXIF         = 0;
+    return &g_chTxReg;
+}
+
+static bit eusart_can_start_rx(void)
+{
+    return SPEN && CREN && ! OERR && g_tRxDone == HOST_NEVER &&
+           g_idxSend < g_cchSend && g_tNow >= g_tSendStart &&
+           host_uart_dtr_asserted() && ! g_bXoff;
+}
+
+static void eusart_sync(void)
+{
+    if (g_tRxDone <= g_tNow)
+    {
+        g_tRxDone = HOST_NEVER;
+
+        if (g_cRxFifo < sizeof(g_achRxFifo))
+        {
+            g_achRxFifo[g_cRxFifo++] = g_chRxShift;
+            g_cReceived++;
+            RCIF = 1;
+        }
+        else
+        {
+            OERR = 1;   // and, as on the real thing, that's the end of that
+            g_cOverruns++;
+        }
+    }
+
+    if (eusart_can_start_rx())
+    {
+        g_chRxShift = g_pchSend[g_idxSend++];
+        g_tRxDone   = g_tNow + eusart_cycles_per_byte();
+    }
+
+    if (g_tTxDone <= g_tNow)
+    {
+        g_tTxDone = HOST_NEVER;
+        TRMT      = 1;
+
+        if (g_chTxShift == 0x11 || g_chTxShift == 0x13)
+            g_bXoff = (g_chTxShift == 0x13);
+
+        if (host_hooks.pfnTransmitted)
+            host_hooks.pfnTransmitted(g_chTxShift);
+    }
+
+    if (g_bTxRegFull && g_tTxDone == HOST_NEVER && SPEN && TXEN)
+    {
+        g_chTxShift  = g_chTxReg;
+        g_bTxRegFull = 0;
+        g_tTxDone    = g_tNow + eusart_cycles_per_byte();
+        TXIF         = 1;
+        TRMT         = 0;
+    }
+
+    RCIDL = (g_tRxDone == HOST_NEVER);
+}
+
+static host_time_t eusart_next_event(void)
+{
+    host_time_t tNext = (g_tRxDone < g_tTxDone) ? g_tRxDone : g_tTxDone;
+
+    if (g_tSendStart > g_tNow && g_tSendStart < tNext)
+        tNext = g_tSendStart;
+
+    if (eusart_can_start_rx() ||
+        (g_bTxRegFull && g_tTxDone == HOST_NEVER && SPEN && TXEN))
+    {
+        tNext = g_tNow;
+    }
+
+    return tNext;
+}
+
+//
+//  Port pins: outputs read back their latch, inputs whatever the outside
+//  world is doing to them.
+//
+static volatile host_sfr_t *const g_apTris[5] =
+    { &host_TRISA, &host_TRISB, &host_TRISC, &host_TRISD, &host_TRISE };
+static volatile host_sfr_t *const g_apLat[5] =
+    { &host_LATA, &host_LATB, &host_LATC, &host_LATD, &host_LATE };
+
+uint8_t host_read_port(uint8_t nPort)
+{
+    uint8_t nTris = g_apTris[nPort]->value;
+    uint8_t nLat  = g_apLat[nPort]->value;
+    uint8_t nPins = typewriter_pins(nPort);
+
+    if (nPort == 0)
+        nPins &= ~0x04;     // nDSR: the host is always ready to receive
+
+    return (nTris & nPins) | (~nTris & nLat);
+}
+
+//
+//  Interrupt-on-change: edges on PORTB set IOCBF bits as enabled by IOCBP and
+//  IOCBN, and IOCIF is simply the OR of those flags.
+//
+static void ioc_sync(uint8_t nOldRows, uint8_t nNewRows)
+{
+    uint8_t nRising  = ~nOldRows &  nNewRows;
+    uint8_t nFalling =  nOldRows & ~nNewRows;
+
+    IOCBF |= (nRising & IOCBP) | (nFalling & IOCBN);
+    IOCIF  = (IOCBF != 0);
+}
+
+//
+//  The simulation loop proper.
+//
+static host_time_t host_next_event(void)
+{
+    host_time_t tNext = timer0_next_event();
+    host_time_t t;
+
+    if ((t = timer1_next_event()) < tNext)
+        tNext = t;
+
+    if ((t = eusart_next_event()) < tNext)
+        tNext = t;
+
+    if ((t = typewriter_next_event()) < tNext)
+        tNext = t;
+
+    return tNext;
+}
+
+static void host_step_to(host_time_t t)
+{
+    uint8_t nOldRows = typewriter_pins(1);
+
+    host_profile_advance(t - g_tNow);
+    g_tNow = t;
+
+    timer0_sync();
+    timer1_sync();
+    eusart_sync();
+    typewriter_sync(t);
+    ioc_sync(nOldRows, typewriter_pins(1));
+
+    if (host_hooks.pfnStep)
+        host_hooks.pfnStep();
+}
+
+static void host_advance_to(host_time_t t)
+{
+    host_time_t tEvent;
+
+    while ((tEvent = host_next_event()) <= t)
+    {
+        host_step_to(tEvent);
+    }
+
+    if (t > g_tNow)
+        host_step_to(t);
+}
+
+static bit host_interrupt_pending(void)
+{
+    if (! GIE)
+        return 0;
+
+    return (TMR0IE && TMR0IF) ||
+           (IOCIE  && IOCIF)  ||
+           (PEIE   && (PIE1 & PIR1));
+}
+
+static void host_service_interrupts(void)
+{
+    while (host_interrupt_pending())
+    {
+        GIE = 0;
+        fast_isr();
+        GIE = 1;
+
+        IOCIF = (IOCBF != 0);   // read-only on the real part
+
+        g_cIsrs++;
+        g_tIsrCycles += HOST_ISR_CYCLES;
+        host_advance_to(g_tNow + HOST_ISR_CYCLES);
+    }
+}
+
+void host_idle(void)
+{
+    host_service_interrupts();
+    host_advance_to(host_next_event());
+    host_service_interrupts();
+}
+
+void host_delay_cycles(uint32_t cCycles)
+{
+    host_time_t tEnd = g_tNow + cCycles;
+
+    while (g_tNow < tEnd)
+    {
+        host_time_t tNext = host_next_event();
+
+        host_service_interrupts();
+        host_advance_to(tNext < tEnd ? tNext : tEnd);
+    }
+
+    host_service_interrupts();
+}
+
+//
+//  Program memory self-read and self-write.  Only the High-Endurance Flash
+//  (the last 128 words) is backed by anything, and it starts off erased;
+//  the rest reads as erased and ignores writes.  Erasing or writing a row
+//  stalls the CPU, so time moves on without interrupts being serviced.
+//
+#define HEF_ADDRESS     0x3f80
+#define HEF_WORDS       128
+#define FLASH_ROW_WORDS 32
+#define FLASH_ERASED    0x3fff
+#define FLASH_WRITE_MS  2
+
+static uint16_t         g_anHef[HEF_WORDS];
+static uint16_t         g_anLatches[FLASH_ROW_WORDS];
+static volatile uint8_t g_nPmcon2       = 0;
+static bit              g_bUnlockBegun  = 0;
+
+volatile uint8_t *host_write_pmcon2(void)
+{
+    //
+    //  The value lands after we return, so it's checked on the next write
+    //  (for the 0x55) or when WR is set (for the 0xaa).
+    //
+    g_bUnlockBegun = (g_nPmcon2 == 0x55);
+    g_nPmcon2      = 0;
+    return &g_nPmcon2;
+}
+
+static uint16_t *flash_word(uint16_t nAddress)
+{
+    if (CFGS || nAddress < HEF_ADDRESS || nAddress >= HEF_ADDRESS + HEF_WORDS)
+        return NULL;
+
+    return &g_anHef[nAddress - HEF_ADDRESS];
+}
+
+static void flash_stall(void)
+{
+    host_advance_to(g_tNow + FLASH_WRITE_MS * (host_time_t) HOST_CYCLES_PER_MS);
+}
+
+static void flash_program(uint16_t nAddress)
+{
+    uint16_t nRow = nAddress & ~(FLASH_ROW_WORDS - 1);
+
+    if (FREE)
+    {
+        for (uint16_t idx = 0; idx < FLASH_ROW_WORDS; idx++)
+        {
+            uint16_t *pnWord = flash_word(nRow + idx);
+
+            if (pnWord)
+                *pnWord = FLASH_ERASED;
+        }
+
+        flash_stall();
+        return;
+    }
+
+    g_anLatches[nAddress % FLASH_ROW_WORDS] = ((PMDATH << 8) | PMDATL)
+                                            & FLASH_ERASED;
+
+    if (LWLO)
+        return;
+
+    for (uint16_t idx = 0; idx < FLASH_ROW_WORDS; idx++)
+    {
+        uint16_t *pnWord = flash_word(nRow + idx);
+
+        if (pnWord)
+            *pnWord &= g_anLatches[idx];    // programming only clears bits
+
+        g_anLatches[idx] = FLASH_ERASED;
+    }
+
+    flash_stall();
+}
+
+void host_nop(void)
+{
+    uint16_t  nAddress = ((PMADRH & 0x7f) << 8) | PMADRL;
+    uint16_t *pnWord   = flash_word(nAddress);
+
+    if (RD)
+    {
+        uint16_t nWord = pnWord ? *pnWord : FLASH_ERASED;
+
+        PMDATL = (uint8_t) nWord;
+        PMDATH = (uint8_t) (nWord >> 8);
+        RD     = 0;
+    }
+
+    if (WR)
+    {
+        if (WREN && g_bUnlockBegun && g_nPmcon2 == 0xaa)
+            flash_program(nAddress);
+
+        g_bUnlockBegun = 0;
+        g_nPmcon2      = 0;
+        WR             = 0;
+    }
+}
+
+//
+//  Power-on reset values, as far as the firmware cares.
+//
+void host_init(void)
+{
+    OPTION_REG = 0xff;
+    TRISA      = 0xff;
+    TRISB      = 0xff;
+    TRISC      = 0xff;
+    TRISD      = 0xff;
+    TRISE      = 0x0f;
+    ANSELA     = 0x2f;
+    ANSELB     = 0x3f;
+    ANSELC     = 0xfc;
+    ANSELD     = 0xff;
+    ANSELE     = 0x07;
+    WPUB       = 0xff;
+    TXSTA      = 0x02;
+    BAUDCON    = 0x40;
+    TXIF       = 1;
+
+    for (uint16_t idx = 0; idx < HEF_WORDS; idx++)
+        g_anHef[idx] = FLASH_ERASED;
+
+    for (uint16_t idx = 0; idx < FLASH_ROW_WORDS; idx++)
+        g_anLatches[idx] = FLASH_ERASED;
+
+    typewriter_init();
+}
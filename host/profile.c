@@ -0,0 +1,87 @@
+//
+//  Attribution of simulated time to whatever the firmware says it's waiting
+//  for (see profile.h), for the benchmark.
+//
+//  The holdoff timer just sums its requests, so each request is queued here
+//  as a segment and consumed in order as time passes; time spent waiting on
+//  the holdoff is charged to the reason of the segment at the head, or to
+//  lining up with the scan once they've all run out.
+//
+
+#include <xc.h>
+#include "host.h"
+
+#define HOLDOFF_QUEUE_LEN 16
+
+static profile_wait_t g_nWait = PROFILE_RUNNING;
+static host_time_t    g_atWaits[PROFILE_MAX];
+
+static struct
+{
+    profile_wait_t nWhy;
+    host_time_t    tLeft;
+} g_aHoldoffs[HOLDOFF_QUEUE_LEN];
+
+static uint8_t g_idxHoldoff = 0;
+static uint8_t g_cHoldoffs  = 0;
+
+void host_profile_wait(uint8_t nWait)
+{
+    g_nWait = nWait;
+}
+
+void host_profile_holdoff(uint8_t nWhy, uint16_t cmsDelay)
+{
+    if (cmsDelay == 0 || g_cHoldoffs == HOLDOFF_QUEUE_LEN)
+        return;
+
+    uint8_t idx = (g_idxHoldoff + g_cHoldoffs++) % HOLDOFF_QUEUE_LEN;
+
+    g_aHoldoffs[idx].nWhy  = nWhy;
+    g_aHoldoffs[idx].tLeft = cmsDelay * (host_time_t) HOST_CYCLES_PER_MS;
+}
+
+//
+//  The firmware stopped the holdoff early, so whatever's left of it won't be
+//  waited for.
+//
+void host_profile_holdoff_cancel(void)
+{
+    g_cHoldoffs = 0;
+}
+
+void host_profile_advance(host_time_t cCycles)
+{
+    while (cCycles)
+    {
+        host_time_t    cSlice = cCycles;
+        profile_wait_t nWait  = g_nWait;
+
+        if (g_cHoldoffs)
+        {
+            if (g_aHoldoffs[g_idxHoldoff].tLeft < cSlice)
+                cSlice = g_aHoldoffs[g_idxHoldoff].tLeft;
+
+            if (nWait == PROFILE_HOLDOFF)
+                nWait = g_aHoldoffs[g_idxHoldoff].nWhy;
+
+            if ((g_aHoldoffs[g_idxHoldoff].tLeft -= cSlice) == 0)
+            {
+                g_idxHoldoff = (g_idxHoldoff + 1) % HOLDOFF_QUEUE_LEN;
+                g_cHoldoffs--;
+            }
+        }
+        else if (nWait == PROFILE_HOLDOFF)
+        {
+            nWait = PROFILE_SCAN_SYNC;
+        }
+
+        g_atWaits[nWait] += cSlice;
+        cCycles          -= cSlice;
+    }
+}
+
+host_time_t host_profile_time(profile_wait_t nWait)
+{
+    return g_atWaits[nWait];
+}
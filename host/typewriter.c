@@ -0,0 +1,762 @@
+//
+//  Model of the typewriter's keyboard scan controller and print mechanism.
+//
+//  The typewriter scans its keyboard in short trains: each of the eight row
+//  strobes on PORTB is pulled low in turn for a few microseconds, and then
+//  the lines sit idle until the next train.  The PIC has to answer each
+//  strobe (by driving the column lines) before the controller samples them
+//  at the end of the pulse.
+//
+//  Each matrix position is debounced over whole scans: a key has to be seen
+//  down for a number of consecutive scans before the controller acts on it,
+//  and anything shorter is reported as a short press (a keystroke the PIC
+//  meant to send but the typewriter never saw).  A key that comes back down
+//  within a few scans of being released is reported as a bounce, since the
+//  typewriter will have typed it twice.
+//
+//  Once a key is registered it drives a simple model of the carriage and
+//  paper; printing, spacing and carriage returns keep the mechanism busy for
+//  a while, and keys registered while it's busy are lost.  Optionally (the
+//  busy_scan_ms option) the controller also scans less often while it's busy,
+//  picking its usual cadence back up as soon as the mechanism is free.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <xc.h>
+#include "host.h"
+#include "keyboard.h"
+#include "typewriter.h"
+
+#define MS(n)           ((host_time_t) ((n) * HOST_CYCLES_PER_MS))
+
+#define PAPER_COLUMNS   132
+#define BOUNCE_SCANS    3       // re-press within this many scans is a bounce
+
+//
+//  Matrix layout, by row strobe and column bit (PORTD 0-7, then PORTC 1-5).
+//
+static const keyid_t g_aMatrix[8][13] = {
+    { KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,
+      KEY_UNKNOWN, KEY_COLON, KEY_UNKNOWN, KEY_UNKNOWN, KEY_TCLR,
+      KEY_UNKNOWN, KEY_G, KEY_H },
+    { KEY_UNKNOWN, KEY_A, KEY_S, KEY_D, KEY_K, KEY_L, KEY_SEMICOLON,
+      KEY_MAR_RTN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_TSET, KEY_F, KEY_J },
+    { KEY_UNKNOWN, KEY_CENTS, KEY_UNKNOWN, KEY_UNKNOWN, KEY_MU, KEY_UNKNOWN,
+      KEY_DASH, KEY_BACKSPC, KEY_UNKNOWN, KEY_UNKNOWN, KEY_MAR_REL,
+      KEY_5, KEY_6 },
+    { KEY_UNKNOWN, KEY_1, KEY_2, KEY_3, KEY_8, KEY_9, KEY_0, KEY_PAPER_UP,
+      KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_4, KEY_7 },
+    { KEY_UNKNOWN, KEY_Q, KEY_W, KEY_E, KEY_I, KEY_O, KEY_P,
+      KEY_PAPER_DOWN, KEY_UNKNOWN, KEY_LMAR, KEY_TAB, KEY_R, KEY_U },
+    { KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_BRACKETS,
+      KEY_UNKNOWN, KEY_AT, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_RMAR,
+      KEY_T, KEY_Y },
+    { KEY_UNKNOWN, KEY_Z, KEY_X, KEY_C, KEY_COMMA, KEY_FULLSTOP,
+      KEY_INDICES, KEY_CRTN, KEY_UNKNOWN, KEY_REPEAT, KEY_LOCK, KEY_V,
+      KEY_M },
+    { KEY_SHIFT, KEY_ANGLES, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,
+      KEY_UNKNOWN, KEY_SLASH, KEY_LINESPACE, KEY_CODE, KEY_SPACE, KEY_ERASE,
+      KEY_B, KEY_N },
+};
+
+//
+//  Key caps: name, and the glyph printed unshifted and shifted (0 for keys
+//  that don't print).
+//
+typedef struct
+{
+    const char *pszName;
+    char        chLower;
+    char        chUpper;
+} keycap_t;
+
+static const keycap_t g_aKeycaps[KEY_MAX] = {
+    [KEY_NONE]       = { "NONE",       0,    0    },
+    [KEY_UNKNOWN]    = { "UNKNOWN",    0,    0    },
+    [KEY_MAR_REL]    = { "MAR_REL",    0,    0    },
+    [KEY_CENTS]      = { "CENTS",      '~',  '^'  },
+    [KEY_1]          = { "1",          '1',  '!'  },
+    [KEY_2]          = { "2",          '2',  '"'  },
+    [KEY_3]          = { "3",          '3',  '#'  },
+    [KEY_4]          = { "4",          '4',  '$'  },
+    [KEY_5]          = { "5",          '5',  '%'  },
+    [KEY_6]          = { "6",          '6',  '&'  },
+    [KEY_7]          = { "7",          '7',  '\'' },
+    [KEY_8]          = { "8",          '8',  '('  },
+    [KEY_9]          = { "9",          '9',  ')'  },
+    [KEY_0]          = { "0",          '0',  '='  },
+    [KEY_DASH]       = { "DASH",       '-',  '_'  },
+    [KEY_MU]         = { "MU",         '|',  '#'  },
+    [KEY_BACKSPC]    = { "BACKSPC",    0,    0    },
+    [KEY_PAPER_UP]   = { "PAPER_UP",   0,    0    },
+    [KEY_LMAR]       = { "LMAR",       0,    0    },
+    [KEY_TAB]        = { "TAB",        0,    0    },
+    [KEY_Q]          = { "Q",          'q',  'Q'  },
+    [KEY_W]          = { "W",          'w',  'W'  },
+    [KEY_E]          = { "E",          'e',  'E'  },
+    [KEY_R]          = { "R",          'r',  'R'  },
+    [KEY_T]          = { "T",          't',  'T'  },
+    [KEY_Y]          = { "Y",          'y',  'Y'  },
+    [KEY_U]          = { "U",          'u',  'U'  },
+    [KEY_I]          = { "I",          'i',  'I'  },
+    [KEY_O]          = { "O",          'o',  'O'  },
+    [KEY_P]          = { "P",          'p',  'P'  },
+    [KEY_AT]         = { "AT",         '@',  '\\' },
+    [KEY_BRACKETS]   = { "BRACKETS",   ']',  '['  },
+    [KEY_CRTN]       = { "CRTN",       0,    0    },
+    [KEY_PAPER_DOWN] = { "PAPER_DOWN", 0,    0    },
+    [KEY_RMAR]       = { "RMAR",       0,    0    },
+    [KEY_LOCK]       = { "LOCK",       0,    0    },
+    [KEY_A]          = { "A",          'a',  'A'  },
+    [KEY_S]          = { "S",          's',  'S'  },
+    [KEY_D]          = { "D",          'd',  'D'  },
+    [KEY_F]          = { "F",          'f',  'F'  },
+    [KEY_G]          = { "G",          'g',  'G'  },
+    [KEY_H]          = { "H",          'h',  'H'  },
+    [KEY_J]          = { "J",          'j',  'J'  },
+    [KEY_K]          = { "K",          'k',  'K'  },
+    [KEY_L]          = { "L",          'l',  'L'  },
+    [KEY_SEMICOLON]  = { "SEMICOLON",  ';',  '+'  },
+    [KEY_COLON]      = { "COLON",      ':',  '*'  },
+    [KEY_INDICES]    = { "INDICES",    '^',  '^'  },
+    [KEY_MAR_RTN]    = { "MAR_RTN",    0,    0    },
+    [KEY_TSET]       = { "TSET",       0,    0    },
+    [KEY_SHIFT]      = { "SHIFT",      0,    0    },
+    [KEY_ANGLES]     = { "ANGLES",     '<',  '>'  },
+    [KEY_Z]          = { "Z",          'z',  'Z'  },
+    [KEY_X]          = { "X",          'x',  'X'  },
+    [KEY_C]          = { "C",          'c',  'C'  },
+    [KEY_V]          = { "V",          'v',  'V'  },
+    [KEY_B]          = { "B",          'b',  'B'  },
+    [KEY_N]          = { "N",          'n',  'N'  },
+    [KEY_M]          = { "M",          'm',  'M'  },
+    [KEY_COMMA]      = { "COMMA",      ',',  ','  },
+    [KEY_FULLSTOP]   = { "FULLSTOP",   '.',  '.'  },
+    [KEY_SLASH]      = { "SLASH",      '/',  '?'  },
+    [KEY_REPEAT]     = { "REPEAT",     0,    0    },
+    [KEY_TCLR]       = { "TCLR",       0,    0    },
+    [KEY_CODE]       = { "CODE",       0,    0    },
+    [KEY_SPACE]      = { "SPACE",      ' ',  ' '  },
+    [KEY_ERASE]      = { "ERASE",      0,    0    },
+    [KEY_LINESPACE]  = { "LINESPACE",  0,    0    },
+};
+
+//
+//  Tunables; see typewriter_set_option() for their names.
+//
+static struct
+{
+    host_time_t tScanPeriod;    // start of one train to the next
+    host_time_t tBusyScan;      // ... while the mechanism is busy (0: same)
+    host_time_t tStrobeLow;     // each row strobe
+    host_time_t tStrobeGap;     // between row strobes
+    uint16_t    cDebounce;      // scans down before a key registers
+
+    host_time_t tPrint;         // print a character and escape
+    host_time_t tEscape;        // space or backspace
+    host_time_t tReturnSettle;  // fixed part of a carriage return...
+    host_time_t tReturnColumn;  // ... and the travel per column
+    host_time_t tTabColumn;     // tab travel per column
+    host_time_t tFeed;          // paper feed, per line
+    host_time_t tTypematicDelay;
+    host_time_t tTypematicRate;
+
+    uint8_t     nLeftMargin;    // power-up settings, in columns
+    uint8_t     nRightMargin;
+} g_config = {
+    .tScanPeriod     = MS(5),
+    .tStrobeLow      = 60,
+    .tStrobeGap      = 12,
+    .cDebounce       = 2,
+
+    .tPrint          = MS(60),
+    .tEscape         = MS(30),
+    .tReturnSettle   = MS(150),
+    .tReturnColumn   = MS(8),
+    .tTabColumn      = MS(4),
+    .tFeed           = MS(80),
+    .tTypematicDelay = MS(400),
+    .tTypematicRate  = MS(77),
+
+    .nLeftMargin     = 10,
+    .nRightMargin    = 75,
+};
+
+//
+//  Scan state
+//
+static uint8_t     g_nRows         = 0xff;
+static uint8_t     g_nRow          = 0;
+static host_time_t g_tScanStart    = 0;
+static host_time_t g_tNextEdge     = HOST_NEVER;
+static host_time_t g_tLastActivity = 0;
+static uint32_t    g_cScans        = 0;
+
+static uint16_t    g_acDown[8][13];         // consecutive scans seen down
+static uint16_t    g_acUp[8][13];           // consecutive scans seen up
+static bit         g_abRegistered[8][13];
+static uint16_t    g_anPhysical[8];         // keys held on the real keyboard
+
+//
+//  Mechanism state
+//
+static host_time_t g_tBusyUntil    = 0;
+static uint8_t     g_nColumn       = 10;
+static uint8_t     g_nLeftMargin   = 10;
+static uint8_t     g_nRightMargin  = 75;
+static bit         g_abTabStops[PAPER_COLUMNS];
+static bit         g_bShift        = 0;
+static bit         g_bLock         = 0;
+static bit         g_bCode         = 0;
+static char        g_chLast        = 0;
+static keyid_t     g_nTypematicKey = KEY_NONE;
+static host_time_t g_tTypematic    = HOST_NEVER;
+
+static char      **g_apszPaper     = NULL;
+static size_t      g_cLines        = 0;
+static size_t      g_nLine         = 0;
+
+//
+//  Statistics
+//
+static typewriter_stats_t g_stats;
+static FILE       *g_pfLog         = NULL;
+
+static void typewriter_log(const char *pszKey, const char *pszEvent,
+                           uint16_t cScans)
+{
+    if (g_pfLog == NULL)
+        return;
+
+    fprintf(g_pfLog, "%12.3f ms  %-10s %-10s scans=%u col=%u\n",
+            (double) host_now() / HOST_CYCLES_PER_MS, pszKey, pszEvent,
+            cScans, g_nColumn);
+}
+
+static char *typewriter_paper_line(void)
+{
+    while (g_nLine >= g_cLines)
+    {
+        g_apszPaper = realloc(g_apszPaper, (g_cLines + 1) * sizeof(char *));
+        g_apszPaper[g_cLines] = malloc(PAPER_COLUMNS);
+
+        if (g_apszPaper == NULL || g_apszPaper[g_cLines] == NULL)
+            abort();
+
+        memset(g_apszPaper[g_cLines++], ' ', PAPER_COLUMNS);
+    }
+
+    return g_apszPaper[g_nLine];
+}
+
+static void typewriter_busy(host_time_t tFor)
+{
+    g_tBusyUntil = host_now() + tFor;
+}
+
+static void typewriter_print(char ch)
+{
+    if (ch != ' ')
+    {
+        typewriter_paper_line()[g_nColumn] = ch;
+        g_stats.cPrinted++;
+        typewriter_busy(g_config.tPrint);
+    }
+    else
+    {
+        g_stats.cSpaces++;
+        typewriter_busy(g_config.tEscape);
+    }
+
+    if (g_nColumn < PAPER_COLUMNS - 1)
+        g_nColumn++;
+
+    g_chLast = ch;
+}
+
+static void typewriter_return(void)
+{
+    uint8_t cColumns = (g_nColumn > g_nLeftMargin) ?
+                       (g_nColumn - g_nLeftMargin) : 0;
+
+    typewriter_busy(g_config.tReturnSettle + cColumns * g_config.tReturnColumn);
+    g_nColumn = g_nLeftMargin;
+    g_nLine++;
+    g_stats.cReturns++;
+}
+
+static void typewriter_tab(void)
+{
+    uint8_t nStop = g_nColumn + 1;
+
+    while (nStop < g_nRightMargin && ! g_abTabStops[nStop])
+        nStop++;
+
+    typewriter_busy(g_config.tEscape +
+                    (nStop - g_nColumn) * g_config.tTabColumn);
+    g_nColumn = nStop;
+    g_stats.cTabs++;
+}
+
+static void typewriter_feed(int cLines)
+{
+    if (cLines < 0 && g_nLine == 0)
+        return;
+
+    g_nLine += cLines;
+    typewriter_busy(g_config.tFeed);
+    g_stats.cFeeds++;
+}
+
+//
+//  The controller has registered a key-down; act on it.
+//
+static void typewriter_key_down(keyid_t nKey, uint16_t cScans)
+{
+    const keycap_t *pCap = &g_aKeycaps[nKey];
+
+    g_tLastActivity = host_now();
+    g_stats.cKeystrokes++;
+
+    switch (nKey)
+    {
+        case KEY_SHIFT:
+            g_bShift = 1;
+            g_bLock  = 0;
+            typewriter_log(pCap->pszName, "down", cScans);
+            return;
+
+        case KEY_LOCK:
+            g_bLock = 1;
+            typewriter_log(pCap->pszName, "down", cScans);
+            return;
+
+        case KEY_CODE:
+            g_bCode = 1;
+            typewriter_log(pCap->pszName, "down", cScans);
+            return;
+    }
+
+    if (host_now() < g_tBusyUntil)
+    {
+        g_stats.cLost++;
+        typewriter_log(pCap->pszName, "LOST(busy)", cScans);
+        return;
+    }
+
+    if (g_bCode)
+    {
+        g_stats.cCode++;
+        typewriter_log(pCap->pszName, "code", cScans);
+        return;
+    }
+
+    typewriter_log(pCap->pszName, "down", cScans);
+
+    switch (nKey)
+    {
+        case KEY_CRTN:
+        case KEY_MAR_RTN:
+            typewriter_return();
+            break;
+
+        case KEY_BACKSPC:
+        case KEY_ERASE:
+            if (g_nColumn > g_nLeftMargin)
+                g_nColumn--;
+
+            if (nKey == KEY_ERASE)
+                typewriter_paper_line()[g_nColumn] = ' ';
+
+            typewriter_busy(g_config.tEscape);
+            g_stats.cBackspaces++;
+            break;
+
+        case KEY_TAB:
+            typewriter_tab();
+            break;
+
+        case KEY_PAPER_UP:
+        case KEY_LINESPACE:
+            typewriter_feed(1);
+            break;
+
+        case KEY_PAPER_DOWN:
+            typewriter_feed(-1);
+            break;
+
+        case KEY_MAR_REL:
+            g_nLeftMargin = 0;
+            break;
+
+        case KEY_LMAR:
+            g_nLeftMargin = g_nColumn;
+            break;
+
+        case KEY_RMAR:
+            g_nRightMargin = g_nColumn;
+            break;
+
+        case KEY_TSET:
+            g_abTabStops[g_nColumn] = 1;
+            break;
+
+        case KEY_TCLR:
+            g_abTabStops[g_nColumn] = 0;
+            break;
+
+        case KEY_REPEAT:
+            g_nTypematicKey = KEY_REPEAT;
+            g_tTypematic    = host_now() + g_config.tTypematicRate;
+
+            if (g_chLast)
+                typewriter_print(g_chLast);
+            break;
+
+        case KEY_SPACE:
+            g_nTypematicKey = KEY_SPACE;
+            g_tTypematic    = host_now() + g_config.tTypematicDelay;
+            typewriter_print(' ');
+            break;
+
+        default:
+            if (pCap->chLower)
+                typewriter_print((g_bShift || g_bLock) ? pCap->chUpper
+                                                       : pCap->chLower);
+            break;
+    }
+}
+
+static void typewriter_key_up(keyid_t nKey, uint16_t cScans)
+{
+    switch (nKey)
+    {
+        case KEY_SHIFT:
+            g_bShift = 0;
+            break;
+
+        case KEY_CODE:
+            g_bCode = 0;
+            break;
+    }
+
+    if (nKey == g_nTypematicKey)
+    {
+        g_nTypematicKey = KEY_NONE;
+        g_tTypematic    = HOST_NEVER;
+    }
+
+    g_stats.cScansHeld += cScans;
+
+    if (g_stats.cMinScans == 0 || cScans < g_stats.cMinScans)
+        g_stats.cMinScans = cScans;
+
+    if (cScans > g_stats.cMaxScans)
+        g_stats.cMaxScans = cScans;
+
+    typewriter_log(g_aKeycaps[nKey].pszName, "up", cScans);
+}
+
+//
+//  Typematic repeat of the Space and Repeat keys, while they're held and the
+//  mechanism is free.
+//
+static void typewriter_typematic(void)
+{
+    if (g_nTypematicKey == KEY_NONE || host_now() < g_tTypematic ||
+        host_now() < g_tBusyUntil)
+    {
+        return;
+    }
+
+    if (g_nTypematicKey == KEY_SPACE)
+        typewriter_print(' ');
+    else if (g_chLast)
+        typewriter_print(g_chLast);
+
+    g_stats.cRepeats++;
+    g_tLastActivity = host_now();
+    g_tTypematic    = host_now() + g_config.tTypematicRate;
+}
+
+//
+//  The controller samples the column lines just before releasing a strobe;
+//  anything pulled low at that moment, by the PIC or by a real key, reads as
+//  a key down.
+//
+static void typewriter_sample_row(uint8_t nRow)
+{
+    uint8_t  nDriveD = ~TRISD & ~LATD;
+    uint8_t  nDriveC = ~TRISC & ~LATC & 0x3e;
+    uint16_t nDown   = nDriveD | ((uint16_t) nDriveC << 7) | g_anPhysical[nRow];
+
+    if (nDown)
+        g_tLastActivity = host_now();
+
+    for (uint8_t nColumn = 0; nColumn < 13; nColumn++)
+    {
+        keyid_t nKey = g_aMatrix[nRow][nColumn];
+
+        if (nDown & (1 << nColumn))
+        {
+            if (g_acDown[nRow][nColumn] == 0 && g_acUp[nRow][nColumn] <= BOUNCE_SCANS
+                                             && g_cScans > BOUNCE_SCANS)
+            {
+                g_stats.cBounces++;
+                typewriter_log(g_aKeycaps[nKey].pszName, "BOUNCE",
+                               g_acUp[nRow][nColumn]);
+            }
+
+            g_acUp[nRow][nColumn] = 0;
+
+            if (++g_acDown[nRow][nColumn] == g_config.cDebounce)
+            {
+                g_abRegistered[nRow][nColumn] = 1;
+
+                if (nKey == KEY_UNKNOWN)
+                    g_stats.cUnknown++;
+                else
+                    typewriter_key_down(nKey, g_config.cDebounce);
+            }
+        }
+        else
+        {
+            uint16_t cScans = g_acDown[nRow][nColumn];
+
+            if (cScans)
+            {
+                if (g_abRegistered[nRow][nColumn])
+                {
+                    typewriter_key_up(nKey, cScans);
+                }
+                else
+                {
+                    g_stats.cShort++;
+                    typewriter_log(g_aKeycaps[nKey].pszName, "SHORT", cScans);
+                }
+            }
+
+            g_abRegistered[nRow][nColumn] = 0;
+            g_acDown[nRow][nColumn]       = 0;
+
+            if (g_acUp[nRow][nColumn] < 0xffff)
+                g_acUp[nRow][nColumn]++;
+        }
+    }
+}
+
+void typewriter_init(void)
+{
+    g_nRows         = 0xff;
+    g_nRow          = 0;
+    g_tScanStart    = g_config.tScanPeriod;
+    g_tNextEdge     = g_tScanStart;
+    g_nColumn       = g_config.nLeftMargin;
+    g_nLeftMargin   = g_config.nLeftMargin;
+    g_nRightMargin  = g_config.nRightMargin;
+
+    memset(g_acUp, 0xff, sizeof(g_acUp));
+}
+
+host_time_t typewriter_next_event(void)
+{
+    host_time_t tTypematic = g_tTypematic;
+
+    if (tTypematic != HOST_NEVER && tTypematic < g_tBusyUntil)
+        tTypematic = g_tBusyUntil;
+
+    return (tTypematic < g_tNextEdge) ? tTypematic : g_tNextEdge;
+}
+
+host_time_t typewriter_last_activity(void)
+{
+    return g_tLastActivity;
+}
+
+void typewriter_sync(host_time_t tNow)
+{
+    while (g_tNextEdge <= tNow)
+    {
+        if (g_nRows == 0xff)
+        {
+            g_nRows      = ~(1 << g_nRow);
+            g_tNextEdge += g_config.tStrobeLow;
+        }
+        else
+        {
+            typewriter_sample_row(g_nRow);
+            g_nRows = 0xff;
+
+            if (++g_nRow < 8)
+            {
+                g_tNextEdge += g_config.tStrobeGap;
+            }
+            else
+            {
+                host_time_t tLast = g_tScanStart;
+
+                g_nRow        = 0;
+                g_cScans++;
+                g_tScanStart += g_config.tScanPeriod;
+
+                if (g_config.tBusyScan && g_tScanStart < g_tBusyUntil)
+                {
+                    g_tScanStart = tLast + g_config.tBusyScan;
+
+                    if (g_tScanStart > g_tBusyUntil)
+                        g_tScanStart = g_tBusyUntil;
+
+                    if (g_tScanStart < tLast + g_config.tScanPeriod)
+                        g_tScanStart = tLast + g_config.tScanPeriod;
+                }
+
+                g_tNextEdge   = g_tScanStart;
+            }
+        }
+    }
+
+    typewriter_typematic();
+}
+
+uint8_t typewriter_pins(uint8_t nPort)
+{
+    uint16_t nDown = 0;
+
+    if (nPort == 1)
+        return g_nRows;
+
+    //
+    //  Keys held on the real keyboard pull their column low while their row
+    //  is strobed.
+    //
+    for (uint8_t nRow = 0; nRow < 8; nRow++)
+    {
+        if (! (g_nRows & (1 << nRow)))
+            nDown |= g_anPhysical[nRow];
+    }
+
+    if (nPort == 3)
+        return ~(uint8_t) nDown;
+
+    if (nPort == 2)
+        return ~(uint8_t) ((nDown >> 7) & 0x3e);
+
+    return 0xff;
+}
+
+//
+//  Hold or release a key on the typewriter's own keyboard.
+//
+void typewriter_physical_key(keyid_t nKey, bit bDown)
+{
+    for (uint8_t nRow = 0; nRow < 8; nRow++)
+    {
+        for (uint8_t nColumn = 0; nColumn < 13; nColumn++)
+        {
+            if (g_aMatrix[nRow][nColumn] != nKey)
+                continue;
+
+            if (bDown)
+                g_anPhysical[nRow] |= (1 << nColumn);
+            else
+                g_anPhysical[nRow] &= ~(1 << nColumn);
+        }
+    }
+}
+
+const typewriter_stats_t *typewriter_stats(void)
+{
+    g_stats.cScans = g_cScans;
+    return &g_stats;
+}
+
+void typewriter_set_log(FILE *pf)
+{
+    g_pfLog = pf;
+}
+
+//
+//  Options are given as name=value, with times in milliseconds (or
+//  microseconds for the strobe timings).
+//
+bit typewriter_set_option(const char *pszName, double nValue)
+{
+    static const struct
+    {
+        const char  *pszName;
+        host_time_t *pt;
+        double       nScale;
+    } s_aTimes[] = {
+        { "scan_ms",       &g_config.tScanPeriod,     HOST_CYCLES_PER_MS },
+        { "busy_scan_ms",  &g_config.tBusyScan,       HOST_CYCLES_PER_MS },
+        { "strobe_us",     &g_config.tStrobeLow,      HOST_CYCLES_PER_US },
+        { "strobe_gap_us", &g_config.tStrobeGap,      HOST_CYCLES_PER_US },
+        { "print_ms",      &g_config.tPrint,          HOST_CYCLES_PER_MS },
+        { "escape_ms",     &g_config.tEscape,         HOST_CYCLES_PER_MS },
+        { "return_ms",     &g_config.tReturnSettle,   HOST_CYCLES_PER_MS },
+        { "return_col_ms", &g_config.tReturnColumn,   HOST_CYCLES_PER_MS },
+        { "tab_col_ms",    &g_config.tTabColumn,      HOST_CYCLES_PER_MS },
+        { "feed_ms",       &g_config.tFeed,           HOST_CYCLES_PER_MS },
+        { "typematic_ms",  &g_config.tTypematicDelay, HOST_CYCLES_PER_MS },
+        { "repeat_ms",     &g_config.tTypematicRate,  HOST_CYCLES_PER_MS },
+    };
+
+    for (size_t idx = 0; idx < sizeof(s_aTimes) / sizeof(s_aTimes[0]); idx++)
+    {
+        if (strcmp(pszName, s_aTimes[idx].pszName) == 0)
+        {
+            *s_aTimes[idx].pt = (host_time_t) (nValue * s_aTimes[idx].nScale);
+            return 1;
+        }
+    }
+
+    if (strcmp(pszName, "debounce") == 0)
+        g_config.cDebounce = (uint16_t) nValue;
+    else if (strcmp(pszName, "left_margin") == 0)
+        g_config.nLeftMargin = (uint8_t) nValue;
+    else if (strcmp(pszName, "right_margin") == 0)
+        g_config.nRightMargin = (uint8_t) nValue;
+    else
+        return 0;
+
+    return 1;
+}
+
+void typewriter_report(FILE *pf)
+{
+    const typewriter_stats_t *pStats = typewriter_stats();
+
+    fprintf(pf,
+            "scans           %10u\n"
+            "keystrokes      %10u (scans held min %u, max %u, mean %.1f)\n"
+            "printed chars   %10u\n"
+            "spaces          %10u\n"
+            "returns         %10u\n"
+            "short presses   %10u\n"
+            "bounces         %10u\n"
+            "lost (busy)     %10u\n",
+            pStats->cScans,
+            pStats->cKeystrokes, pStats->cMinScans, pStats->cMaxScans,
+            pStats->cKeystrokes ? (double) pStats->cScansHeld
+                                  / pStats->cKeystrokes : 0.0,
+            pStats->cPrinted,
+            pStats->cSpaces,
+            pStats->cReturns,
+            pStats->cShort,
+            pStats->cBounces,
+            pStats->cLost);
+}
+
+void typewriter_dump_paper(FILE *pf)
+{
+    for (size_t nLine = 0; nLine < g_cLines; nLine++)
+    {
+        int cch = PAPER_COLUMNS;
+
+        while (cch > 0 && g_apszPaper[nLine][cch - 1] == ' ')
+            cch--;
+
+        fprintf(pf, "%.*s\n", cch, g_apszPaper[nLine]);
+    }
+}
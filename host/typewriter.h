@@ -0,0 +1,59 @@
+/*
+ * File:   typewriter.h
+ *
+ * Model of the typewriter's keyboard scan controller, as seen from the
+ * PIC's row strobe and column pins, and of the print mechanism behind it.
+ */
+
+#ifndef TYPEWRITER_H
+#define	TYPEWRITER_H
+
+#include <stdio.h>
+#include "host.h"
+#include "keyboard.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef struct
+    {
+        uint32_t cScans;        // complete scan trains
+        uint32_t cKeystrokes;   // keys registered by the controller
+        uint32_t cScansHeld;    // ... and the total scans they were held for
+        uint32_t cMinScans;
+        uint32_t cMaxScans;
+        uint32_t cPrinted;      // characters put on paper
+        uint32_t cSpaces;
+        uint32_t cBackspaces;
+        uint32_t cTabs;
+        uint32_t cReturns;
+        uint32_t cFeeds;
+        uint32_t cRepeats;      // typematic repeats
+        uint32_t cCode;         // Code-shifted function keys
+        uint32_t cUnknown;      // columns with no key behind them
+        uint32_t cShort;        // down, but released before registering
+        uint32_t cBounces;      // re-pressed straight after release
+        uint32_t cLost;         // registered while the mechanism was busy
+    } typewriter_stats_t;
+
+    extern void        typewriter_init(void);
+    extern host_time_t typewriter_next_event(void);
+    extern void        typewriter_sync(host_time_t tNow);
+    extern uint8_t     typewriter_pins(uint8_t nPort);
+    extern host_time_t typewriter_last_activity(void);
+
+    extern void        typewriter_physical_key(keyid_t nKey, bit bDown);
+    extern bit         typewriter_set_option(const char *pszName,
+                                             double nValue);
+    extern void        typewriter_set_log(FILE *pf);
+
+    extern const typewriter_stats_t *typewriter_stats(void);
+    extern void        typewriter_report(FILE *pf);
+    extern void        typewriter_dump_paper(FILE *pf);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TYPEWRITER_H */
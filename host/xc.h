@@ -0,0 +1,265 @@
+/*
+ * File:   xc.h
+ *
+ * Host-build stand-in for the XC8 device header.  Every SFR the firmware
+ * touches is backed by a variable in the emulated register file (see
+ * pic16f1519.c); the handful of registers whose reads or writes have side
+ * effects on real silicon (the port pins, RCREG, TXREG and PMCON2) are
+ * routed through accessor functions instead, so the emulated peripherals see
+ * them.
+ */
+
+#ifndef HOST_XC_H
+#define	HOST_XC_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+//
+//  XC8 language extensions
+//
+typedef _Bool bit;
+
+#define NOP()           host_nop()
+#define CLRWDT()
+#define di()            (GIE = 0)
+#define ei()            (GIE = 1)
+
+#define __delay_ms(x)   host_delay_cycles((uint32_t) ((x) * (_XTAL_FREQ / 4000UL)))
+#define __delay_us(x)   host_delay_cycles((uint32_t) ((x) * (_XTAL_FREQ / 4000000UL)))
+
+//
+//  The XC8 library sends putchar() output through the user-supplied putch();
+//  do the same here, rather than letting it escape to the host's stdout.
+//
+extern void putch(char c);
+
+#undef  putchar
+#define putchar(c)      putch(c)
+
+//
+//  The emulated register file
+//
+typedef union
+{
+    uint8_t value;
+    struct
+    {
+        unsigned b0 : 1;
+        unsigned b1 : 1;
+        unsigned b2 : 1;
+        unsigned b3 : 1;
+        unsigned b4 : 1;
+        unsigned b5 : 1;
+        unsigned b6 : 1;
+        unsigned b7 : 1;
+    };
+} host_sfr_t;
+
+#define HOST_SFR(name)  extern volatile host_sfr_t host_##name
+
+HOST_SFR(INTCON);
+HOST_SFR(OPTION_REG);
+HOST_SFR(PIR1);
+HOST_SFR(PIE1);
+HOST_SFR(TMR0);
+HOST_SFR(TMR1L);
+HOST_SFR(TMR1H);
+HOST_SFR(T1CON);
+HOST_SFR(LATA);
+HOST_SFR(LATB);
+HOST_SFR(LATC);
+HOST_SFR(LATD);
+HOST_SFR(LATE);
+HOST_SFR(TRISA);
+HOST_SFR(TRISB);
+HOST_SFR(TRISC);
+HOST_SFR(TRISD);
+HOST_SFR(TRISE);
+HOST_SFR(ANSELA);
+HOST_SFR(ANSELB);
+HOST_SFR(ANSELC);
+HOST_SFR(ANSELD);
+HOST_SFR(ANSELE);
+HOST_SFR(WPUB);
+HOST_SFR(IOCBP);
+HOST_SFR(IOCBN);
+HOST_SFR(IOCBF);
+HOST_SFR(RCSTA);
+HOST_SFR(TXSTA);
+HOST_SFR(BAUDCON);
+HOST_SFR(SPBRGL);
+HOST_SFR(SPBRGH);
+HOST_SFR(PMADRL);
+HOST_SFR(PMADRH);
+HOST_SFR(PMDATL);
+HOST_SFR(PMDATH);
+HOST_SFR(PMCON1);
+
+#define INTCON      host_INTCON.value
+#define GIE         host_INTCON.b7
+#define PEIE        host_INTCON.b6
+#define TMR0IE      host_INTCON.b5
+#define INTE        host_INTCON.b4
+#define IOCIE       host_INTCON.b3
+#define TMR0IF      host_INTCON.b2
+#define INTF        host_INTCON.b1
+#define IOCIF       host_INTCON.b0
+
+#define OPTION_REG  host_OPTION_REG.value
+#define nWPUEN      host_OPTION_REG.b7
+#define INTEDG      host_OPTION_REG.b6
+#define TMR0CS      host_OPTION_REG.b5
+#define TMR0SE      host_OPTION_REG.b4
+#define PSA         host_OPTION_REG.b3
+#define PS2         host_OPTION_REG.b2
+#define PS1         host_OPTION_REG.b1
+#define PS0         host_OPTION_REG.b0
+
+#define PIR1        host_PIR1.value
+#define TMR1GIF     host_PIR1.b7
+#define RCIF        host_PIR1.b5
+#define TXIF        host_PIR1.b4
+#define TMR1IF      host_PIR1.b0
+
+#define PIE1        host_PIE1.value
+#define TMR1GIE     host_PIE1.b7
+#define RCIE        host_PIE1.b5
+#define TXIE        host_PIE1.b4
+#define TMR1IE      host_PIE1.b0
+
+#define TMR0        host_TMR0.value
+#define TMR1L       host_TMR1L.value
+#define TMR1H       host_TMR1H.value
+
+#define T1CON       host_T1CON.value
+#define TMR1CS1     host_T1CON.b7
+#define TMR1CS0     host_T1CON.b6
+#define T1CKPS1     host_T1CON.b5
+#define T1CKPS0     host_T1CON.b4
+#define T1OSCEN     host_T1CON.b3
+#define nT1SYNC     host_T1CON.b2
+#define TMR1ON      host_T1CON.b0
+
+#define LATA        host_LATA.value
+#define LATA0       host_LATA.b0
+#define LATA1       host_LATA.b1
+#define LATA2       host_LATA.b2
+#define LATA3       host_LATA.b3
+#define LATB        host_LATB.value
+#define LATC        host_LATC.value
+#define LATD        host_LATD.value
+#define LATE        host_LATE.value
+
+#define TRISA       host_TRISA.value
+#define TRISA0      host_TRISA.b0
+#define TRISA1      host_TRISA.b1
+#define TRISA2      host_TRISA.b2
+#define TRISA3      host_TRISA.b3
+#define TRISB       host_TRISB.value
+#define TRISC       host_TRISC.value
+#define TRISC6      host_TRISC.b6
+#define TRISC7      host_TRISC.b7
+#define TRISD       host_TRISD.value
+#define TRISE       host_TRISE.value
+
+#define ANSELA      host_ANSELA.value
+#define ANSELB      host_ANSELB.value
+#define ANSELC      host_ANSELC.value
+#define ANSELD      host_ANSELD.value
+#define ANSELE      host_ANSELE.value
+
+#define WPUB        host_WPUB.value
+#define IOCBP       host_IOCBP.value
+#define IOCBN       host_IOCBN.value
+#define IOCBF       host_IOCBF.value
+
+#define RCSTA       host_RCSTA.value
+#define SPEN        host_RCSTA.b7
+#define RX9         host_RCSTA.b6
+#define CREN        host_RCSTA.b4
+#define FERR        host_RCSTA.b2
+#define OERR        host_RCSTA.b1
+
+#define TXSTA       host_TXSTA.value
+#define TX9         host_TXSTA.b6
+#define TXEN        host_TXSTA.b5
+#define SYNC        host_TXSTA.b4
+#define BRGH        host_TXSTA.b2
+#define TRMT        host_TXSTA.b1
+
+#define BAUDCON     host_BAUDCON.value
+#define ABDOVF      host_BAUDCON.b7
+#define RCIDL       host_BAUDCON.b6
+#define BRG16       host_BAUDCON.b3
+#define WUE         host_BAUDCON.b1
+#define ABDEN       host_BAUDCON.b0
+
+#define SPBRG       host_SPBRGL.value
+#define SPBRGL      host_SPBRGL.value
+#define SPBRGH      host_SPBRGH.value
+
+#define PMADRL      host_PMADRL.value
+#define PMADRH      host_PMADRH.value
+#define PMDATL      host_PMDATL.value
+#define PMDATH      host_PMDATH.value
+
+#define PMCON1      host_PMCON1.value
+#define CFGS        host_PMCON1.b6
+#define LWLO        host_PMCON1.b5
+#define FREE        host_PMCON1.b4
+#define WRERR       host_PMCON1.b3
+#define WREN        host_PMCON1.b2
+#define WR          host_PMCON1.b1
+#define RD          host_PMCON1.b0
+
+//
+//  Registers with side effects: port reads sample the emulated pins at the
+//  current simulated instant, reading RCREG pops the receive FIFO, writing
+//  TXREG queues a byte for the transmit shift register and writes to PMCON2
+//  make up the flash unlock sequence.
+//
+extern uint8_t           host_read_port(uint8_t nPort);
+extern char              host_read_rcreg(void);
+extern volatile uint8_t *host_write_txreg(void);
+extern volatile uint8_t *host_write_pmcon2(void);
+
+#define PORTA       host_read_port(0)
+#define PORTB       host_read_port(1)
+#define PORTC       host_read_port(2)
+#define PORTD       host_read_port(3)
+#define PORTE       host_read_port(4)
+#define PORTA2      ((PORTA >> 2) & 1)
+
+#define RCREG       host_read_rcreg()
+#define TXREG       (*host_write_txreg())
+#define PMCON2      (*host_write_pmcon2())
+
+//
+//  Simulated-time hooks used in place of the PIC's delay loops and spins.
+//
+extern void host_idle(void);
+extern void host_delay_cycles(uint32_t cCycles);
+
+//
+//  Flash reads and writes take effect on the NOP()s the firmware has to
+//  follow RD and WR with anyway.
+//
+extern void host_nop(void);
+
+//
+//  Benchmark probes; see profile.h.
+//
+extern void host_profile_wait(uint8_t nWait);
+extern void host_profile_holdoff(uint8_t nWhy, uint16_t cmsDelay);
+extern void host_profile_holdoff_cancel(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* HOST_XC_H */
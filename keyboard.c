@@ -2,99 +2,78 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "keyboard.h"
+#include "keymap.h"
+#include "keytables.h"
 #include "timers.h"
+#include "profile.h"
+#include "nv.h"
 
-#define KEYSTROKE_GAP   30      // milliseconds between keystrokes
+#define KEYSTROKE_GAP   30      // milliseconds between keystrokes...
+#define KEYSTROKE_GAP_ESCAPE 20 // ... after a space or backspace...
+#define KEYSTROKE_GAP_FEED   60 // ... and after the paper's fed
 #define KEYSTROKE_TICKS 10      // scan ticks for a keystroke
+#define KEYSTROKE_TICKS_MAX 40  // ... or as many as a class of key can ask for
 #define KEYCHORD_BEFORE  3      // scan ticks either side of a chorded keystroke
 #define KEYCHORD_AFTER   2
+#define KEYSTROKE_UP_SCANS 4    // scans between keystrokes at the very least,
+                                // so a repeated key isn't taken for a bounce
+#define SAVE_SCANS_MS   100     // longest to wait for the scans after a save
+#define TEST_WAIT_MS    2000    // ... and for the typewriter around a test key
 
-#define SCANS_PER_TICK  17      // number of individual scan pulses in a train
+//
+//  Timer1 (see timers.c) free-runs at Fcy/2, so its high byte counts at 9kHz;
+//  that's fine enough to timestamp scan trains and wraps slowly enough (28ms)
+//  to measure the period between them.  A train is a burst of strobe pulses,
+//  so the first pulse after a millisecond or more of quiet starts a new one.
+//
+#define SCAN_TICKS_PER_MS   (TIMERS_TICKS_PER_MS / 256)
+#define SCAN_QUIET_TICKS    SCAN_TICKS_PER_MS
+
+#if SCAN_TICKS_PER_MS < 2
+# error Crystal frequency too low to timestamp scans with the Timer1 high byte.
+#endif
 
 //
 //  Table of internal key IDs based on the order of the bits that represent
-//  them in the raw scan data (bits 0->12 of rows 0->7).
-//
-static const keyid_t g_aKeyIDs[] = {
-    /* row 0 */
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_COLON, KEY_UNKNOWN,
-    KEY_UNKNOWN, KEY_TCLR, KEY_UNKNOWN, KEY_G, KEY_H,
-    
-    /* row 1 */
-    KEY_UNKNOWN, KEY_A, KEY_S, KEY_D,
-    KEY_K, KEY_L, KEY_SEMICOLON, KEY_MAR_RTN,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_TSET, KEY_F, KEY_J,
-    
-    /* row 2 */
-    KEY_UNKNOWN, KEY_CENTS, KEY_UNKNOWN, KEY_UNKNOWN,
-    KEY_MU, KEY_UNKNOWN, KEY_DASH, KEY_BACKSPC,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_MAR_REL, KEY_5, KEY_6,
-    
-    /* row 3 */
-    KEY_UNKNOWN, KEY_1, KEY_2, KEY_3,
-    KEY_8, KEY_9, KEY_0, KEY_PAPER_UP,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_4, KEY_7,
-    
-    /* row 4 */
-    KEY_UNKNOWN, KEY_Q, KEY_W, KEY_E,
-    KEY_I, KEY_O, KEY_P, KEY_PAPER_DOWN,
-    KEY_UNKNOWN, KEY_LMAR, KEY_TAB, KEY_R, KEY_U,
-    
-    /* row 5 */
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,
-    KEY_BRACKETS, KEY_UNKNOWN, KEY_AT, KEY_UNKNOWN,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_RMAR, KEY_T, KEY_Y,
-    
-    /* row 6 */
-    KEY_UNKNOWN, KEY_Z, KEY_X, KEY_C,
-    KEY_COMMA, KEY_FULLSTOP, KEY_INDICES, KEY_CRTN,
-    KEY_UNKNOWN, KEY_REPEAT, KEY_LOCK, KEY_V, KEY_M,
-    
-    /* row 7 */
-    KEY_SHIFT, KEY_ANGLES, KEY_UNKNOWN, KEY_UNKNOWN,
-    KEY_UNKNOWN, KEY_UNKNOWN, KEY_SLASH, KEY_LINESPACE,
-    KEY_CODE, KEY_SPACE, KEY_ERASE, KEY_B, KEY_N,  
-};
+//  them in the raw scan data (bits 0->12 of rows 0->7); see keymap.h.
+//
+static const keyid_t g_aKeyIDs[] = KEYMAP_SCAN_IDS;
 
+//
+//  ... and the other way round: the strobe row and column pins for each key,
+//  active low, as generated from the above into keytables.h.
+//
 typedef struct
 {
     uint8_t row;
     uint8_t columns[2];
 } keyscan_t;
 
-static keyscan_t g_aKeyScans[KEY_MAX] = { 0 };
+static const keyscan_t g_aKeyScans[KEY_MAX] = KEYTABLE_SCANS;
 
-static void keyboard_init_scan_table(void)
+//
+//  Each class of key (see keymap.h) is held down for its own number of scans
+//  (as read back; see keyboard_inject_isr) and has its own gap afterwards,
+//  so that keys which don't keep the typewriter busy for long needn't pay
+//  for those that do.  The timings can be tuned at run time, and are kept in
+//  flash between power-ups.
+//
+typedef struct
 {
-    uint8_t nKeyCode = 0;
-    
-    for (uint8_t nRow = 0; nRow < 8; nRow++)
-    {
-        for (uint8_t nColumn = 0; nColumn < 13; nColumn++, nKeyCode++)
-        {
-            keyid_t nKey = g_aKeyIDs[nKeyCode];
-            
-            g_aKeyScans[nKey].row        = 0xff;
-            g_aKeyScans[nKey].columns[0] = 0xff;
-            g_aKeyScans[nKey].columns[1] = 0x3e;
-                
-            if (nKey != KEY_NONE && nKey != KEY_UNKNOWN && nKey < KEY_MAX)
-            {
-                g_aKeyScans[nKey].row &= ~(1<<nRow);
-                
-                if (nColumn < 8)
-                {
-                    g_aKeyScans[nKey].columns[0] &= ~(1<<nColumn);
-                }
-                else
-                {
-                    g_aKeyScans[nKey].columns[1] &= ~(1<<(nColumn-7));
-                }
-            }
-        }
-    }
-}
+    uint8_t cPressScans;
+    uint8_t cmsGap;
+} keytiming_t;
+
+static const uint8_t g_anKeyClasses[KEY_MAX] = KEYTABLE_CLASSES;
+
+static const keytiming_t g_aDefaultTimings[KEYCLASS_MAX] = {
+    /* KEYCLASS_PRINT    */ { KEYSTROKE_TICKS, KEYSTROKE_GAP        },
+    /* KEYCLASS_ESCAPE   */ { KEYSTROKE_TICKS, KEYSTROKE_GAP_ESCAPE },
+    /* KEYCLASS_FEED     */ { KEYSTROKE_TICKS, KEYSTROKE_GAP_FEED   },
+    /* KEYCLASS_FUNCTION */ { KEYSTROKE_TICKS, KEYSTROKE_GAP        },
+};
+
+static keytiming_t g_aKeyTimings[KEYCLASS_MAX];
 
 //
 //  The keyboard event queue contains one record for each key-down or key-up
@@ -107,8 +86,21 @@ static keyevent_t g_anEvents[EVENTQUEUE_LEN] = { KEY_NONE };
 static uint8_t    g_idxEventRead  = 0;
 static uint8_t    g_idxEventWrite = 0;
 
+//
+//  When each event was seen, on the low 16 bits of the millisecond clock;
+//  that's when the scan data was processed, so up to a scan after the key
+//  actually moved.
+//
+#if KEYBOARD_EVENT_TIMES
+static uint16_t   g_amsEvents[EVENTQUEUE_LEN];
+static uint16_t   g_msLastEvent   = 0;
+#endif
+
 static void keyboard_queue_event(keyevent_t nEvent)
 {
+#if KEYBOARD_EVENT_TIMES
+    g_amsEvents[g_idxEventWrite] = (uint16_t) timers_get_ms();
+#endif
     g_anEvents[g_idxEventWrite++] = nEvent;
     
     if (g_idxEventWrite >= EVENTQUEUE_LEN)
@@ -121,6 +113,9 @@ keyevent_t keyboard_get_next_event(void)
     
     if (g_idxEventRead != g_idxEventWrite)
     {
+#if KEYBOARD_EVENT_TIMES
+        g_msLastEvent = g_amsEvents[g_idxEventRead];
+#endif
         nEvent = g_anEvents[g_idxEventRead++];
         
         if (g_idxEventRead >= EVENTQUEUE_LEN)
@@ -132,6 +127,19 @@ keyevent_t keyboard_get_next_event(void)
     return nEvent;
 }
 
+//
+//  When the event keyboard_get_next_event() last returned was seen, or 0 if
+//  events aren't timestamped.
+//
+uint16_t keyboard_get_event_ms(void)
+{
+#if KEYBOARD_EVENT_TIMES
+    return g_msLastEvent;
+#else
+    return 0;
+#endif
+}
+
 inline bit keyboard_is_down_event(const keyevent_t nEvent)
 {
     return (nEvent & KEY_RELEASED) == 0x00;
@@ -143,22 +151,38 @@ inline keyid_t keyboard_get_event_key(const keyevent_t nEvent)
 }
 
 //
-//  Find the lowest set bit in n; implemented using a lookup table rather than
-//  the obvious loop over (1<<nBit) because I'm pretty sure free XC8 will do
+//  Find the lowest set bit in n, counting from 1 (or 0 if there isn't one);
+//  implemented using a lookup table a nibble at a time rather than the
+//  obvious loop over (1<<nBit) because I'm pretty sure free XC8 will do
 //  something horrendous with that...
 //
-static const uint8_t g_anBits[8] =
-    { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+static const uint8_t g_anLowestBit[16] =
+    { 0, 1, 2, 1, 3, 1, 2, 1, 4, 1, 2, 1, 3, 1, 2, 1 };
 
 static uint8_t lowest_bit(uint8_t n)
 {   
-    for (char nBit = 0; nBit < 8; nBit++)
-        if (n & g_anBits[nBit])
-            return nBit + 1;
+    if (n & 0x0f)
+        return g_anLowestBit[n & 0x0f];
+    
+    if (n)
+        return 4 + g_anLowestBit[n >> 4];
     
     return 0;
 }
 
+//
+//  These values are used by the fast ISR to inject keystrokes; ticks is the
+//  number of scan cycles the keystroke should be injected for, and the data
+//  array is a sparsely-populated table of TRISx data.  For a given value of
+//  the row strobes, data[strobes] contains TRISD and data[~strobes] TRISC.
+//
+static volatile uint8_t g_inject_ticks;
+#ifndef HOST_BUILD
+static volatile uint8_t g_inject_data[256] @ 0x2000;
+#else
+static volatile uint8_t g_inject_data[256];
+#endif
+
 //
 //  The keyboard ISR comes in two halves; a fast half and a medium-speed half.
 //  The medium-speed half is here, and handles reading the current state of
@@ -173,12 +197,145 @@ static uint8_t lowest_bit(uint8_t n)
 //  updates an internal map of the entire keyboard matrix, and generates
 //  key-up/key-down events as appropriate.
 //
+//  There are two capture buffers, so the ISR can carry on filling one while
+//  the main loop works through the other; each complete scan bumps the
+//  sequence number, and the one that was last handed over is recorded with
+//  it so the main loop can tell how many it missed.  The ISR won't swap
+//  buffers while the main loop has one claimed, so those scans go missing
+//  as well (but that only takes as long as one pass over the rows).
+//
 static struct
 {
-    uint8_t pending;
-    uint8_t scan_state[8][2];
+    uint8_t          pending;
+    uint8_t          fill;
+    volatile uint8_t ready;         // handed between the ISR and main loop
+    volatile uint8_t ready_seq;
+    uint8_t          sequence;
+    volatile uint8_t claimed;
+    uint8_t          scan_state[2][8][2];
 } g_ISRdata;
 
+static void keyboard_inject_isr(uint8_t nScan);
+
+//
+//  The key being injected, if any (a zero row otherwise), so the ISR can
+//  count the scans in which its column pins actually read back low; that's
+//  what says the typewriter had a chance to see it.
+//
+static uint8_t g_nVerifyRow     = 0;
+static uint8_t g_nVerifyCol0    = 0;
+static uint8_t g_nVerifyCol1    = 0;
+static uint8_t g_cPressedScans  = 0;
+static bit     g_bPressedThisScan = 0;
+
+//
+//  Scan tracking, in Timer1 high-byte ticks: when the current train started,
+//  the measured period between trains, and how many pulses the ISR saw in
+//  the last complete train (which replaces the 17 we used to assume).
+//
+static uint8_t g_tLastPulse    = 0;
+static uint8_t g_tScanStart    = 0;
+static uint8_t g_ctScanPeriod  = 0;
+static uint8_t g_cTrainPulses  = 0;
+static uint8_t g_cScanPulses   = 0;
+
+#define SCAN_TRAIN_START    0x01
+#define SCAN_TRAIN_END      0x02
+
+//
+//  The typewriter's controller scans less often while the mechanism is busy,
+//  so a train that starts late means it's still printing or moving; the first
+//  one back on time means it's ready for the next key.  The period above only
+//  follows on-time trains, so it stays the idle cadence; if trains keep on
+//  coming late for long enough, though, that must be the new cadence.
+//
+#define SCAN_LATE_TICKS     SCAN_TICKS_PER_MS   // slack before a train is late
+#define SCAN_LATE_ADOPT     200                 // late trains in a row that
+                                                // set a new period
+static uint16_t g_tLongScanStart = 0;
+static uint8_t  g_cLateScans     = 0;
+static bit      g_bScanLate      = 0;           // the current train was late
+static bit      g_bBusySeen      = 0;           // it's gone late since the
+                                                // last keystroke was pressed
+static volatile uint8_t g_cUntimedScans = 0;    // trains not to time, after
+                                                // we've stalled the CPU
+
+static void keyboard_time_scan(void)
+{
+    uint16_t tStart   = timers_get_high_ticks();
+    uint16_t ctPeriod = tStart - g_tLongScanStart;
+    
+    g_tLongScanStart = tStart;
+    
+    if (g_cUntimedScans)
+    {
+        g_cUntimedScans--;
+        return;
+    }
+    
+    if (g_ctScanPeriod == 0 || ctPeriod <= g_ctScanPeriod + SCAN_LATE_TICKS ||
+        (ctPeriod <= 0xff && g_cLateScans >= SCAN_LATE_ADOPT))
+    {
+        g_ctScanPeriod = (ctPeriod > 0xff) ? 0xff : (uint8_t) ctPeriod;
+        g_cLateScans   = 0;
+        g_bScanLate    = 0;
+    }
+    else
+    {
+        if (g_cLateScans < 0xff)
+            g_cLateScans++;
+        
+        if (! g_bScanLate)
+            g_bBusySeen = 1;    // it's started on something new
+        
+        g_bScanLate = 1;
+    }
+}
+
+//
+//  Is the typewriter busy, going by its scan cadence?  Either the last train
+//  came late, or the next one is overdue already.
+//
+bit keyboard_is_typewriter_busy(void)
+{
+    uint8_t bOldIE = IOCIE;
+    bit     bBusy;
+    
+    IOCIE = 0;
+    bBusy = g_bScanLate || (uint16_t) (timers_get_high_ticks() - g_tLongScanStart)
+                           > g_ctScanPeriod + SCAN_LATE_TICKS;
+    IOCIE = bOldIE;
+    
+    return bBusy;
+}
+
+//
+//  Timestamp a scan pulse; returns SCAN_TRAIN_START if it's the first pulse
+//  of a train and SCAN_TRAIN_END if it's the last (as far as we can tell from
+//  the count in the previous train).
+//
+static uint8_t keyboard_track_scan(void)
+{
+    uint8_t tNow  = TMR1H;
+    uint8_t nScan = 0;
+    
+    if ((uint8_t) (tNow - g_tLastPulse) >= SCAN_QUIET_TICKS)
+    {
+        keyboard_time_scan();
+        g_tScanStart   = tNow;
+        g_cScanPulses  = g_cTrainPulses;
+        g_cTrainPulses = 0;
+        nScan          = SCAN_TRAIN_START;
+    }
+    
+    g_tLastPulse = tNow;
+    
+    if (++g_cTrainPulses == g_cScanPulses)
+        nScan |= SCAN_TRAIN_END;
+    
+    return nScan;
+}
+
 //
 //  The medium-speed ISR
 //
@@ -199,14 +356,41 @@ void keyboard_isr(void)
     //
     IOCIF = 0;
     
+    uint8_t nScan = keyboard_track_scan();
+    
     if (row_pins == 0xff)
     {
         TRISD  = 0xff;
         TRISC |= 0x3e;
         IOCBF  = 0;
+        keyboard_inject_isr(nScan);
         return; // nothing to do, we were too late to see the strobe pins
     }
     
+    //
+    //  Read back the key we're injecting, if this is its row (the first time
+    //  in this scan; a row can be seen twice if an interrupt runs late)...
+    //
+    if (nScan & SCAN_TRAIN_START)
+        g_bPressedThisScan = 0;
+    
+    if (row_pins == g_nVerifyRow && ! g_bPressedThisScan &&
+        ! (columns[0] & ~g_nVerifyCol0) &&
+        ! (columns[1] & ~g_nVerifyCol1 & 0x3e))
+    {
+        g_bPressedThisScan = 1;
+        
+        if (g_cPressedScans < 0xff)
+            g_cPressedScans++;
+    }
+    
+    //
+    //  ... then, since any keys we're injecting show up on the column pins as
+    //  well, mask them out so that only keys the user pressed generate events.
+    //
+    columns[0] |= ~g_inject_data[row_pins];
+    columns[1] |= ~g_inject_data[(uint8_t) ~row_pins] & 0x3e;
+    
     //
     //  Only store the captured data in the ISR state if this row hasn't been
     //  seen already...
@@ -214,9 +398,27 @@ void keyboard_isr(void)
     if (g_ISRdata.pending & ~row_pins)
     {
         uint8_t row = lowest_bit(~row_pins) - 1;
-        g_ISRdata.scan_state[row][0] = ~columns[0];
-        g_ISRdata.scan_state[row][1] = ~columns[1];
+        g_ISRdata.scan_state[g_ISRdata.fill][row][0] = ~columns[0];
+        g_ISRdata.scan_state[g_ISRdata.fill][row][1] = ~columns[1];
         g_ISRdata.pending &= row_pins;
+        
+        //
+        //  ... and once every row's been seen, hand the buffer over to the
+        //  main loop and start on the other one.
+        //
+        if (! g_ISRdata.pending)
+        {
+            g_ISRdata.sequence++;
+            
+            if (! g_ISRdata.claimed)
+            {
+                g_ISRdata.ready     = g_ISRdata.fill;
+                g_ISRdata.ready_seq = g_ISRdata.sequence;
+                g_ISRdata.fill     ^= 1;
+            }
+            
+            g_ISRdata.pending = 0xff;
+        }
     }
     
     IOCBF &= row_pins;
@@ -226,17 +428,10 @@ void keyboard_isr(void)
         TRISD  = 0xff;
         TRISC |= 0x3e;
     }
+    
+    keyboard_inject_isr(nScan);
 }
 
-//
-//  These values are used by the fast ISR to inject keystrokes; ticks is the
-//  number of scan cycles the keystroke should be injected for, and the data
-//  array is a sparsely-populated table of TRISx data.  For a given value of
-//  the row strobes, data[strobes] contains TRISD and data[~strobes] TRISC.
-//
-static volatile uint8_t g_inject_ticks;
-static volatile uint8_t g_inject_data[256] @ 0x2000;
-
 //
 //  The fast half of the keyboard ISR is here; it's placed as the main ISR
 //  for the entire application, and calls back to the medium/slow ISR defined
@@ -244,6 +439,7 @@ static volatile uint8_t g_inject_data[256] @ 0x2000;
 //
 extern void main_isr(void);
 
+#ifndef HOST_BUILD
 asm("FNCALL _main,_fast_isr");
 
 void fast_isr(void) @ 0x0004
@@ -280,6 +476,29 @@ _endasm
     main_isr();
     asm("RETFIE");
 }
+#else
+//
+//  The host build has no assembler, so does the same thing in C; the emulated
+//  PIC calls this whenever an enabled interrupt flag is set.
+//
+void fast_isr(void)
+{
+    if (IOCIF)
+    {
+        uint8_t strobes = PORTB;
+        
+        TRISD = g_inject_data[strobes];
+        TRISC = g_inject_data[(uint8_t) ~strobes];
+        
+        if (g_inject_ticks)
+            g_inject_ticks--;
+        
+        keyboard_isr();
+    }
+    
+    main_isr();
+}
+#endif
 
 //
 //  Given a key's scan data, set it to be injected by the fast ISR.
@@ -313,70 +532,46 @@ static void keyboard_set_key_up(uint8_t row, uint8_t col0, uint8_t col1)
 
 //
 //  The non-interrupt-context routines to track the keyboard state and
-//  generate key-up/key-down events.
+//  generate key-up/key-down events.  The state is kept packed in the same
+//  form as the scan data, so a row that hasn't changed costs one compare per
+//  byte, and only the bits that have changed get looked at.
 //
-static uint8_t g_aKeystates[8 * 13] = { 0 };
+static uint8_t g_aKeystates[8][2] = { 0 };
 
 //
 //  Given a row's worth of keyboard scan data, generate appropriate events.
 //
 static void keyboard_update_row_state(uint8_t row, uint8_t columns[2])
 {
-    keyid_t nKey = row * 13;
-    uint8_t nBit;
-    
     if (columns[0] == 0xff && (columns[1] & 0x3e) == 0x3e)
         return; // ghosted row, ignore entirely
     
-    for (nBit = 0x01; nBit; nKey++, nBit += nBit)
+    for (uint8_t idx = 0; idx < 2; idx++)
     {
-        if (columns[0] & nBit)
-        {            
-            //
-            //  The key is down...
-            //
-            if (! g_aKeystates[nKey])
-            {
-                g_aKeystates[nKey] = 1;
-                keyboard_queue_event(g_aKeyIDs[nKey]);
-            }
-        }
-        else
-        {
-            //
-            //  ... the key is up
-            //
-            if (g_aKeystates[nKey])
-            {
-                g_aKeystates[nKey] = 0;
-                keyboard_queue_event(g_aKeyIDs[nKey] | KEY_RELEASED);
-            }
-        }
-    }
-    
-    for (nBit = 0x02; nBit < 0x40; nKey++, nBit += nBit)
-    {
-        if (columns[1] & nBit)
-        {
-            //
-            //  The key is down...
-            //
-            if (! g_aKeystates[nKey])
-            {
-                g_aKeystates[nKey] = 1;
-                keyboard_queue_event(g_aKeyIDs[nKey]);
-            }
-        }
-        else
+        uint8_t nNew   = idx ? (columns[1] & 0x3e) : columns[0];
+        uint8_t nDelta = nNew ^ g_aKeystates[row][idx];
+        
+        if (nDelta == 0)
+            continue;
+        
+        g_aKeystates[row][idx] = nNew;
+        
+        while (nDelta)
         {
             //
-            //  ... the key is up
+            //  Columns 0-7 are bits 0-7 of the first byte, and 8-12 are bits
+            //  1-5 of the second.
             //
-            if (g_aKeystates[nKey])
-            {
-                g_aKeystates[nKey] = 0;
-                keyboard_queue_event(g_aKeyIDs[nKey] | KEY_RELEASED);
-            }
+            uint8_t nBit    = lowest_bit(nDelta) - 1;
+            keyid_t nKey    = g_aKeyIDs[row * 13 + (idx ? 7 : 0) + nBit];
+            uint8_t fColumn = nDelta & (uint8_t) -nDelta;
+            
+            nDelta ^= fColumn;
+            
+            if (nNew & fColumn)
+                keyboard_queue_event(nKey);                   // key went down
+            else
+                keyboard_queue_event(nKey | KEY_RELEASED);    // ... or up
         }
     }
 }
@@ -384,31 +579,44 @@ static void keyboard_update_row_state(uint8_t row, uint8_t columns[2])
 //
 //  The main routine to drive the keyboard event generation
 //
+static uint8_t  g_nLastScanSeq  = 0;
+static uint16_t g_cScansSkipped = 0;
+
 void keyboard_update(void)
 {
     //
-    //  Early exit if we haven't seen scan data from every row yet.
+    //  Early exit if there's no new complete scan since last time.
     //
-    if (g_ISRdata.pending)
+    if (g_ISRdata.ready_seq == g_nLastScanSeq)
         return;
     
     //
-    //  Now work through the accumulated scan data by rows, looking for changes;
-    //  since we haven't yet reset the pending row flags, the ISR won't change
-    //  any of the data out from under us.
+    //  Claim the buffer before looking at which one it is, so the ISR can't
+    //  swap it out from under us; then work through it by rows, looking for
+    //  changes.
     // 
+    g_ISRdata.claimed = 1;
+    
+    uint8_t nSeq = g_ISRdata.ready_seq;
+    uint8_t (*pScan)[2] = g_ISRdata.scan_state[g_ISRdata.ready];
+    
+    g_cScansSkipped += (uint8_t) (nSeq - g_nLastScanSeq - 1);
+    g_nLastScanSeq   = nSeq;
+    
     for (uint8_t nRow = 0; nRow < 8; nRow++)   
     {
-        keyboard_update_row_state(nRow, g_ISRdata.scan_state[nRow]);
-        
-        g_ISRdata.scan_state[nRow][0] = 0xff;
-        g_ISRdata.scan_state[nRow][1] = 0x3e;
+        keyboard_update_row_state(nRow, pScan[nRow]);
     }
     
-    //
-    //  Now allow the ISR to accumulate scan data once more.
-    //
-    g_ISRdata.pending = 0xff;
+    g_ISRdata.claimed = 0;
+}
+
+//
+//  Number of complete scans the main loop never got to look at.
+//
+uint16_t keyboard_get_scans_skipped(void)
+{
+    return g_cScansSkipped;
 }
 
 //
@@ -432,6 +640,15 @@ static void keyboard_init_injection_data(void)
     g_inject_ticks = 0;    
 }
 
+static void keyboard_init_timings(void)
+{
+    if (nv_load((uint8_t *) g_aKeyTimings, sizeof(g_aKeyTimings)))
+        return;
+    
+    for (uint8_t idx = 0; idx < KEYCLASS_MAX; idx++)
+        g_aKeyTimings[idx] = g_aDefaultTimings[idx];
+}
+
 //
 //  Initialize the keyboard driver
 //
@@ -458,97 +675,438 @@ void keyboard_init(void)
     //
     //  Get our data structures in order...
     //
-    keyboard_init_scan_table();
     keyboard_init_injection_data();
+    keyboard_init_timings();
     
     //
-    //  We want an interrupt every time a pin goes low (-> a row is scanned)
+    //  We want an interrupt every time a pin goes low (-> a row is
+    //  scanned).  There's no need to line up with the scan first; the ISR
+    //  finds the start of each train by its timestamps.
     //
     IOCBN = 0xff;
     IOCBP = 0xff;
     
-    //
-    //  ... wait until we're in sync with the typewriter's scan sequence, by
-    //  waiting for a scan pulse on the row strobes and then delaying long
-    //  enough to land in the gap between scans.
-    //
-    while (PORTB == 0xff)
-        ;
-    
-    timers_block_ms(4);
-    
     g_ISRdata.pending = 0xff;
     IOCIF = 0;
     IOCIE = 1;
 }
 
-static char keyboard_complete_scan_disable_interrupts()
+//
+//  Keystrokes waiting to be injected; the main loop queues them up and returns
+//  straight away, and the keyboard ISR works through them one at a time.  An
+//  entry with a zero hold row is a plain keystroke, otherwise the hold key is
+//  pressed first and released last (e.g. Shift for a capital letter).
+//
+#define KEYQUEUE_LEN 8
+
+typedef struct
+{
+    keyscan_t hold;
+    keyscan_t key;
+    uint8_t   cTicks;       // scan ticks to hold the key down for...
+    uint8_t   cScans;       // ... or until it's read back for this many
+                            // scans; zero for a hold, which lasts its ticks
+    uint8_t   cmsGap;       // holdoff to start once the keys are released...
+    uint16_t  cmsDelay;     // ... and any more asked for after this one
+    uint16_t  ctGap;        // the two together, in Timer1 high-byte ticks
+    uint16_t  ctHold;       // how long a hold lasts, in the same ticks
+} keystroke_t;
+
+static keystroke_t      g_aKeystrokes[KEYQUEUE_LEN];
+static volatile uint8_t g_idxKeystrokeRead  = 0;
+static volatile uint8_t g_idxKeystrokeWrite = 0;
+
+static enum
 {
-    char enabled = IOCBN;
+    INJECT_IDLE = 0,        // waiting for a keystroke and the gap before it
+    INJECT_HOLD,            // hold key down before the keystroke
+    INJECT_KEY,             // both keys down
+    INJECT_RELEASE,         // hold key still down after the keystroke
+    INJECT_RELEASED,        // waiting for the typewriter to see the release
+} g_nInjectState = INJECT_IDLE;
+
+static uint8_t g_cHoldTicks = 0;    // left after the current g_inject_ticks
+static uint16_t g_tHoldEnd  = 0;    // ... or when a long hold ends, anyway
+
+static uint16_t g_cUnverified  = 0;     // keystrokes released before they'd
+                                        // been read back for long enough
+
+//
+//  The holdoff before the next keystroke is timed on the same clock as the
+//  scans, from when it started, so the ISR can start and check it with a
+//  subtraction and compare; the main loop works out each keystroke's ticks
+//  when it's queued, since there's no multiplier.  That limits a holdoff to
+//  the seven seconds or so before the clock wraps.
+//
+static uint16_t g_tHoldoffStart = 0;
+static uint16_t g_ctHoldoff     = 0;
+static bit      g_bHoldoff      = 0;
+
+static uint16_t keyboard_ms_to_ticks(uint16_t cms)
+{
+    if (cms > 0xffff / SCAN_TICKS_PER_MS)
+        return 0xffff;
     
-    if (enabled)
+    return cms * SCAN_TICKS_PER_MS;
+}
+
+static uint16_t keyboard_get_holdoff_ticks(void)
+{
+    return timers_get_high_ticks() - g_tHoldoffStart;
+}
+
+//
+//  Start the holdoff, or if it's already running add to the time it has
+//  left.
+//
+static void keyboard_start_holdoff(uint16_t ctHoldoff)
+{
+    if (g_bHoldoff && keyboard_get_holdoff_ticks() < g_ctHoldoff)
     {
-        // wait for the next scan to complete, if running
-        while (g_ISRdata.pending)
-            ;
+        g_ctHoldoff += ctHoldoff;
+        
+        if (g_ctHoldoff < ctHoldoff)
+            g_ctHoldoff = 0xffff;
+    }
+    else
+    {
+        g_tHoldoffStart = timers_get_high_ticks();
+        g_ctHoldoff     = ctHoldoff;
+        g_bHoldoff      = (ctHoldoff != 0);
     }
+}
+
+static bit keyboard_is_holdoff_running(void)
+{
+    uint8_t bOldIE = IOCIE;
+    bit     bRunning;
     
-    IOCBN = 0;
-    IOCBP = 0;
-    IOCBF = 0;
-    return enabled;
+    IOCIE    = 0;
+    bRunning = g_bHoldoff && keyboard_get_holdoff_ticks() < g_ctHoldoff;
+    
+    if (! bRunning)
+        g_bHoldoff = 0;     // so it doesn't come back once the clock wraps
+    
+    IOCIE = bOldIE;
+    
+    return bRunning;
 }
 
-static void keyboard_wait_ticks(uint8_t nTicks)
+//
+//  Scan ticks are only ever one to three, so add them up rather than
+//  multiply.
+//
+static void keyboard_start_ticks(uint8_t nTicks)
 {
-    g_inject_ticks = nTicks * SCANS_PER_TICK;
+    uint16_t cPulses = 0;
+    
+    while (nTicks--)
+        cPulses += g_cScanPulses;
     
-    while (g_inject_ticks)
-        ;
+    g_inject_ticks = (cPulses > 0xff) ? 0xff : (uint8_t) cPulses;
 }
 
-static void keyboard_send_key_chord(uint8_t row_1, uint8_t col0_1, uint8_t col1_1,
-                                    uint8_t row_2, uint8_t col0_2, uint8_t col1_2)
+//
+//  Called at the end of a scan train: will the holdoff have run out before
+//  the next train starts?  If so, a key pressed now won't be seen by the
+//  typewriter until after the gap anyway, so there's no need to wait a whole
+//  scan period for the holdoff to finish.
+//
+static uint8_t keyboard_is_holdoff_over_by_next_scan(void)
 {
-    while (timers_is_holdoff_running())
-        ;   // sanity check in case someone calls us when they shouldn't
+    uint8_t ctLeft;
+    
+    if (! keyboard_is_holdoff_running())
+        return 1;
     
-    char interrupts_enabled = keyboard_complete_scan_disable_interrupts();
+    ctLeft = (uint8_t) (g_tScanStart + g_ctScanPeriod - TMR1H);
+    
+    if (ctLeft > g_ctScanPeriod)
+        return 0;   // the next train is overdue; don't trust the estimate
+    
+    return (uint16_t) (keyboard_get_holdoff_ticks() + ctLeft) >= g_ctHoldoff;
+}
 
-    do
+//
+//  Keys are held a tick at a time, so holds can be longer than the 8-bit
+//  pulse counter would allow.  Holds are for the typewriter's own autorepeat,
+//  which runs to time rather than scans, so they're also given a deadline in
+//  case the scans slow down while it's busy printing.
+//
+static void keyboard_press_key(const keystroke_t *pKeystroke)
+{
+    keyboard_set_key_down(pKeystroke->key.row,
+                          pKeystroke->key.columns[0],
+                          pKeystroke->key.columns[1]);
+    keyboard_start_ticks(1);
+    g_nVerifyRow   = pKeystroke->key.row;
+    g_nVerifyCol0  = pKeystroke->key.columns[0];
+    g_nVerifyCol1  = pKeystroke->key.columns[1];
+    g_cPressedScans = 0;
+    g_cHoldTicks   = pKeystroke->cTicks - 1;
+    g_tHoldEnd     = timers_get_high_ticks() + pKeystroke->ctHold;
+    g_nInjectState = INJECT_KEY;
+}
+
+static void keyboard_press_first_key(const keystroke_t *pKeystroke)
+{
+    profile_wait(PROFILE_KEYSTROKE);
+    g_bBusySeen = 0;
+    
+    if (pKeystroke->hold.row)
     {
-        // wait for scanning to be idle before selecting the target row
-        while (PORTB == 0xff)
-            ;   // now we're in a scan pulse...
-        
-        timers_block_ms(4);  // ... so this should land us in the dead period
+        keyboard_set_key_down(pKeystroke->hold.row,
+                              pKeystroke->hold.columns[0],
+                              pKeystroke->hold.columns[1]);
+        keyboard_start_ticks(KEYCHORD_BEFORE);
+        g_nInjectState = INJECT_HOLD;
+    }
+    else
+    {
+        keyboard_press_key(pKeystroke);
     }
-    while (PORTB != 0xff);  // but make sure it has before continuing
+}
+
+//
+//  Once the typewriter has gone busy after a keystroke and then come back to
+//  its usual scan cadence, it's ready for the next one; the holdoff is only a
+//  safety net for when the cadence doesn't tell us anything.
+//
+static uint8_t g_cGapScans = 0;
+
+static uint8_t keyboard_is_ready_for_key(void)
+{
+    if (! g_bBusySeen || g_bScanLate || g_cGapScans < KEYSTROKE_UP_SCANS)
+        return keyboard_is_holdoff_over_by_next_scan();
     
-    IOCBF = 0;
-    IOCBN = interrupts_enabled;
-    IOCBP = interrupts_enabled;
+    if (keyboard_is_holdoff_running())
+    {
+        g_bHoldoff = 0;
+        profile_holdoff_cancel();
+    }
+    
+    return 1;
+}
 
-    if (row_1)
+//
+//  The typewriter only notices a key has been released on its next scan, so
+//  that's where the gap before the next keystroke is timed from.
+//
+static void keyboard_start_gap(const keystroke_t *pKeystroke)
+{
+    keyboard_start_holdoff(pKeystroke->ctGap);
+    g_cGapScans = 1;
+    profile_holdoff(PROFILE_GAP, pKeystroke->cmsGap);
+    profile_holdoff(PROFILE_RETURN, pKeystroke->cmsDelay);
+    profile_wait(PROFILE_HOLDOFF);
+    
+    if (++g_idxKeystrokeRead >= KEYQUEUE_LEN)
+        g_idxKeystrokeRead = 0;
+    
+    g_nInjectState = INJECT_IDLE;
+}
+
+//
+//  The injection state machine, run from the keyboard ISR on every scan pulse
+//  once the fast ISR has counted it off g_inject_ticks; nScan says whether
+//  the pulse started or ended a train.  Keys are pressed in the quiet spell
+//  after a train so they're seen for whole scans, and each step then waits
+//  for the tick counter to run out.
+//
+static void keyboard_inject_isr(uint8_t nScan)
+{
+    const keystroke_t *pKeystroke = &g_aKeystrokes[g_idxKeystrokeRead];
+    
+    if ((nScan & SCAN_TRAIN_START) && g_cGapScans < 0xff)
+        g_cGapScans++;
+    
+    switch (g_nInjectState)
     {
-        keyboard_set_key_down(row_1, col0_1, col1_1);    
-        keyboard_wait_ticks(KEYCHORD_BEFORE);
+        case INJECT_IDLE:
+            if (g_idxKeystrokeRead == g_idxKeystrokeWrite)
+            {
+                (void) keyboard_is_holdoff_running();   // let it lapse
+                profile_wait(PROFILE_IDLE);
+                break;
+            }
+            
+            profile_wait(PROFILE_HOLDOFF);
+            
+            if ((nScan & SCAN_TRAIN_END) && keyboard_is_ready_for_key())
+                keyboard_press_first_key(pKeystroke);
+            break;
+            
+        case INJECT_HOLD:
+            if (g_inject_ticks)
+                break;
+            
+            keyboard_press_key(pKeystroke);
+            break;
+            
+        case INJECT_KEY:
+            //
+            //  If the typewriter's gone busy it must have seen the key, so
+            //  a keystroke (as opposed to a hold) needn't be held any longer,
+            //  however long its press length is.  Otherwise,
+            //  it's been down for long enough once it's been read back for
+            //  as many scans as asked, and is let go between trains (a late
+            //  interrupt could still put it back on the pins mid-train).
+            //
+            if ((g_bBusySeen && pKeystroke->cScans) ||
+                ((nScan & SCAN_TRAIN_END) && pKeystroke->cScans &&
+                 g_cPressedScans >= pKeystroke->cScans))
+            {
+                g_inject_ticks = 0;
+                g_cHoldTicks   = 0;
+            }
+            
+            if (g_inject_ticks)
+                break;
+            
+            if (g_cHoldTicks &&
+                (pKeystroke->cScans ||
+                 (int16_t) (timers_get_high_ticks() - g_tHoldEnd) < 0))
+            {
+                g_cHoldTicks--;
+                keyboard_start_ticks(1);
+                break;
+            }
+            
+            keyboard_set_key_up(pKeystroke->key.row,
+                                pKeystroke->key.columns[0],
+                                pKeystroke->key.columns[1]);
+            g_nVerifyRow = 0;
+            
+            if (g_cPressedScans < pKeystroke->cScans)
+                g_cUnverified++;
+            
+            if (pKeystroke->hold.row)
+            {
+                keyboard_start_ticks(KEYCHORD_AFTER);
+                g_nInjectState = INJECT_RELEASE;
+            }
+            else
+            {
+                profile_wait(PROFILE_GAP);
+                g_nInjectState = INJECT_RELEASED;
+            }
+            break;
+            
+        case INJECT_RELEASE:
+            if (g_inject_ticks)
+                break;
+            
+            keyboard_set_key_up(pKeystroke->hold.row,
+                                pKeystroke->hold.columns[0],
+                                pKeystroke->hold.columns[1]);
+            profile_wait(PROFILE_GAP);
+            g_nInjectState = INJECT_RELEASED;
+            break;
+            
+        case INJECT_RELEASED:
+            if (nScan & SCAN_TRAIN_START)
+                keyboard_start_gap(pKeystroke);
+            break;
     }
+}
+
+bit keyboard_is_sending(void)
+{
+    return g_idxKeystrokeRead != g_idxKeystrokeWrite;
+}
+
+uint8_t keyboard_get_queue_space(void)
+{
+    uint8_t idxRead = g_idxKeystrokeRead;
     
-    keyboard_set_key_down(row_2, col0_2, col1_2);
-    keyboard_wait_ticks(KEYSTROKE_TICKS);
-    keyboard_set_key_up(row_2, col0_2, col1_2);
+    return (idxRead > g_idxKeystrokeWrite) ?
+           (idxRead - g_idxKeystrokeWrite - 1) :
+           (KEYQUEUE_LEN - g_idxKeystrokeWrite + idxRead - 1);
+}
 
-    if (row_1)
+static void keyboard_send_key_chord(uint8_t row_1, uint8_t col0_1, uint8_t col1_1,
+                                    uint8_t row_2, uint8_t col0_2, uint8_t col1_2,
+                                    uint8_t cTicks, uint8_t cScans,
+                                    uint8_t cmsGap)
+{
+    while (keyboard_get_queue_space() == 0)
+        timers_idle();  // wait for the ISR to make room
+    
+    keystroke_t *pKeystroke = &g_aKeystrokes[g_idxKeystrokeWrite];
+    
+    pKeystroke->hold.row        = row_1;
+    pKeystroke->hold.columns[0] = col0_1;
+    pKeystroke->hold.columns[1] = col1_1;
+    pKeystroke->key.row         = row_2;
+    pKeystroke->key.columns[0]  = col0_2;
+    pKeystroke->key.columns[1]  = col1_2;
+    pKeystroke->cTicks          = cTicks;
+    pKeystroke->cScans          = cScans;
+    pKeystroke->cmsGap          = cmsGap;
+    pKeystroke->cmsDelay        = 0;
+    pKeystroke->ctGap           = keyboard_ms_to_ticks(cmsGap);
+    pKeystroke->ctHold          = cScans ? 0 : (uint16_t) cTicks * g_ctScanPeriod
+                                               - g_ctScanPeriod / 2;
+    
+    uint8_t idxWrite = g_idxKeystrokeWrite + 1;
+    
+    if (idxWrite >= KEYQUEUE_LEN)
+        idxWrite = 0;
+    
+    g_idxKeystrokeWrite = idxWrite;
+}
+
+//
+//  Lengthen the gap after the most recently sent keystroke, e.g. to let the
+//  carriage return before the next one; if it's already been typed, just
+//  extend the holdoff it left running.
+//
+void keyboard_send_delay_ms(uint16_t cmsDelay)
+{
+    uint8_t bOldIE = IOCIE;
+    
+    IOCIE = 0;
+    
+    if (g_idxKeystrokeRead != g_idxKeystrokeWrite)
+    {
+        uint8_t idxLast = (g_idxKeystrokeWrite ? g_idxKeystrokeWrite
+                                               : KEYQUEUE_LEN) - 1;
+        
+        keystroke_t *pKeystroke = &g_aKeystrokes[idxLast];
+        
+        pKeystroke->cmsDelay += cmsDelay;
+        pKeystroke->ctGap     = keyboard_ms_to_ticks(pKeystroke->cmsGap +
+                                                     pKeystroke->cmsDelay);
+    }
+    else
     {
-        keyboard_wait_ticks(KEYCHORD_AFTER);
-        keyboard_set_key_up(row_1, col0_1, col1_1);
+        keyboard_start_holdoff(keyboard_ms_to_ticks(cmsDelay));
+        profile_holdoff(PROFILE_RETURN, cmsDelay);
     }
+    
+    IOCIE = bOldIE;
+}
 
-    timers_start_holdoff_ms(KEYSTROKE_GAP);
+//
+//  Ordinary keystrokes are held until they've been read back for as many
+//  scans as their class asks for; if the column pins can't be read back,
+//  that's for KEYSTROKE_TICKS (or the class's press length, if longer).
+//
+static void keyboard_send_classed_chord(uint8_t row_1, uint8_t col0_1, uint8_t col1_1,
+                                        keyid_t nKey)
+{
+    const keytiming_t *pTiming = &g_aKeyTimings[g_anKeyClasses[nKey]];
+    uint8_t            cScans  = pTiming->cPressScans;
+    
+    keyboard_send_key_chord(row_1, col0_1, col1_1,
+                            g_aKeyScans[nKey].row,
+                            g_aKeyScans[nKey].columns[0],
+                            g_aKeyScans[nKey].columns[1],
+                            (cScans > KEYSTROKE_TICKS) ? cScans : KEYSTROKE_TICKS,
+                            cScans, pTiming->cmsGap);
 }
 
-#define keyboard_send_key(row, col0, col1) keyboard_send_key_chord(0, 0, 0, row, col0, col1)
+#define keyboard_send_key(row, col0, col1) keyboard_send_key_chord(0, 0, 0, row, col0, col1, KEYSTROKE_TICKS, g_aKeyTimings[KEYCLASS_PRINT].cPressScans, g_aKeyTimings[KEYCLASS_PRINT].cmsGap)
 
 void keyboard_send_balj(void)
 {
@@ -568,9 +1126,169 @@ void keyboard_send_keystroke(keyid_t nKey)
     if (nRow == 0 || nRow == 0xff)
         return;
     
-    keyboard_send_key(nRow,
-                      g_aKeyScans[nKey].columns[0],
-                      g_aKeyScans[nKey].columns[1]);
+    keyboard_send_classed_chord(0, 0, 0, nKey);
+}
+
+//
+//  Hold a key down for longer than a normal keystroke, e.g. to let the
+//  typewriter's own typematic repeat do some of the typing; returns whether
+//  it was queued, as it isn't if that wouldn't be any longer.
+//
+bit keyboard_send_keyhold(keyid_t nKey, uint8_t cTicks)
+{
+    if (nKey >= KEY_MAX || cTicks < KEYSTROKE_TICKS)
+        return 0;
+    
+    uint8_t nRow = g_aKeyScans[nKey].row;
+    
+    if (nRow == 0 || nRow == 0xff)
+        return 0;
+    
+    keyboard_send_key_chord(0, 0, 0,
+                            nRow,
+                            g_aKeyScans[nKey].columns[0],
+                            g_aKeyScans[nKey].columns[1],
+                            cTicks, 0, g_aKeyTimings[g_anKeyClasses[nKey]].cmsGap);
+    
+    return 1;
+}
+
+//
+//  How long a class of key is held down, in scans read back off the column
+//  pins; zero goes back to KEYSTROKE_TICKS.
+//
+void keyboard_set_press_scans(keyclass_t nClass, uint8_t cScans)
+{
+    if (nClass >= KEYCLASS_MAX)
+        return;
+    
+    if (cScans == 0)
+        cScans = KEYSTROKE_TICKS;
+    else if (cScans > KEYSTROKE_TICKS_MAX)
+        cScans = KEYSTROKE_TICKS_MAX;
+    
+    g_aKeyTimings[nClass].cPressScans = cScans;
+}
+
+uint8_t keyboard_get_press_scans(keyclass_t nClass)
+{
+    return (nClass < KEYCLASS_MAX) ? g_aKeyTimings[nClass].cPressScans : 0;
+}
+
+//
+//  How long the gap after a class of key is, in milliseconds; anything the
+//  typewriter needs on top of that for a particular keystroke (e.g. to
+//  return the carriage) is asked for with keyboard_send_delay_ms().
+//
+void keyboard_set_gap_ms(keyclass_t nClass, uint8_t cmsGap)
+{
+    if (nClass < KEYCLASS_MAX)
+        g_aKeyTimings[nClass].cmsGap = cmsGap;
+}
+
+uint8_t keyboard_get_gap_ms(keyclass_t nClass)
+{
+    return (nClass < KEYCLASS_MAX) ? g_aKeyTimings[nClass].cmsGap : 0;
+}
+
+//
+//  Keep the key timings in flash for next time.  The CPU stalls while they're
+//  written, so wait until we're not in the middle of a keystroke; the scans
+//  the ISR missed meanwhile look just like the typewriter going busy, so wait
+//  for the cadence to settle again afterwards, too.
+//
+void keyboard_save_timings(void)
+{
+    while (keyboard_is_sending())
+        timers_idle();
+    
+    //
+    //  The CPU stalls while the row is written, so the first train we see
+    //  afterwards may be late or only partly caught, and the one after that
+    //  is timed from it; neither says anything about the typewriter's cadence.
+    //
+    g_cUntimedScans = 2;
+    nv_save((const uint8_t *) g_aKeyTimings, sizeof(g_aKeyTimings));
+    
+    uint32_t msStart = timers_get_ms();
+    
+    while (g_cUntimedScans && timers_get_ms() - msStart < SAVE_SCANS_MS)
+        timers_idle();
+    
+    g_cUntimedScans = 0;    // in case the typewriter isn't scanning at all
+}
+
+//
+//  How many keystrokes were let go before they'd been read back for as many
+//  scans as they should have been.
+//
+uint16_t keyboard_get_unverified(void)
+{
+    return g_cUnverified;
+}
+
+//
+//  For calibration: type a keystroke held for exactly cScans scans (as read
+//  back), wait for it and the gap after it, and say whether the typewriter's
+//  scan cadence showed it acting on the key.  If the typewriter won't settle
+//  down before or after, that's taken as not.
+//
+bit keyboard_test_keypress(keyid_t nKey, uint8_t cScans)
+{
+    if (nKey >= KEY_MAX || cScans == 0 || cScans > KEYSTROKE_TICKS)
+        return 0;
+    
+    uint8_t nRow = g_aKeyScans[nKey].row;
+    
+    if (nRow == 0 || nRow == 0xff)
+        return 0;
+    
+    uint32_t msStart = timers_get_ms();
+    
+    while (keyboard_is_sending() || keyboard_is_holdoff_running() ||
+           keyboard_is_typewriter_busy())
+    {
+        if (timers_get_ms() - msStart >= TEST_WAIT_MS)
+            return 0;   // it's not scanning, or never settles
+        
+        timers_idle();
+    }
+    
+    keyboard_send_key_chord(0, 0, 0,
+                            nRow,
+                            g_aKeyScans[nKey].columns[0],
+                            g_aKeyScans[nKey].columns[1],
+                            KEYSTROKE_TICKS, cScans,
+                            g_aKeyTimings[g_anKeyClasses[nKey]].cmsGap);
+    
+    msStart = timers_get_ms();
+    
+    while (keyboard_is_sending() || keyboard_is_holdoff_running())
+    {
+        if (timers_get_ms() - msStart >= TEST_WAIT_MS)
+            return 0;
+        
+        timers_idle();
+    }
+    
+    return g_bBusySeen;
+}
+
+//
+//  How many scans (rounded to the nearest) the typewriter makes in cmsPeriod
+//  milliseconds, going by the measured scan period; 0 if it's not known yet.
+//
+uint8_t keyboard_get_scans_in_ms(uint16_t cmsPeriod)
+{
+    uint8_t  ctScanPeriod = g_ctScanPeriod;
+    uint16_t cScans;
+    
+    if (ctScanPeriod == 0)
+        return 0;
+    
+    cScans = (cmsPeriod * SCAN_TICKS_PER_MS + ctScanPeriod / 2) / ctScanPeriod;
+    
+    return (cScans > 0xff) ? 0xff : (uint8_t) cScans;
 }
 
 void keyboard_send_keychord(keyid_t nHoldKey, keyid_t nKey)
@@ -584,10 +1302,53 @@ void keyboard_send_keychord(keyid_t nHoldKey, keyid_t nKey)
     if (nRow == 0 || nRow == 0xff || nHoldRow == 0 || nHoldRow == 0xff)
         return;
     
-    keyboard_send_key_chord(nHoldRow,
-                            g_aKeyScans[nHoldKey].columns[0],
-                            g_aKeyScans[nHoldKey].columns[1],
+    keyboard_send_classed_chord(nHoldRow,
+                                g_aKeyScans[nHoldKey].columns[0],
+                                g_aKeyScans[nHoldKey].columns[1],
+                                nKey);
+}
+
+//
+//  Send a keystroke, chorded with nHoldKey unless that's KEY_NONE, held for
+//  cScans and with a gap of cmsGap after it, for a host that plans its own
+//  timings; zero for either takes the key's class timing instead.
+//
+void keyboard_send_timed_keychord(keyid_t nHoldKey, keyid_t nKey,
+                                  uint8_t cScans, uint8_t cmsGap)
+{
+    const keytiming_t *pTiming;
+    keyscan_t          hold = { 0, { 0, 0 } };
+    
+    if (nKey >= KEY_MAX || nHoldKey >= KEY_MAX)
+        return;
+    
+    uint8_t nRow = g_aKeyScans[nKey].row;
+    
+    if (nRow == 0 || nRow == 0xff)
+        return;
+    
+    if (nHoldKey != KEY_NONE)
+    {
+        hold = g_aKeyScans[nHoldKey];
+        
+        if (hold.row == 0 || hold.row == 0xff)
+            return;
+    }
+    
+    pTiming = &g_aKeyTimings[g_anKeyClasses[nKey]];
+    
+    if (cScans == 0)
+        cScans = pTiming->cPressScans;
+    else if (cScans > KEYSTROKE_TICKS_MAX)
+        cScans = KEYSTROKE_TICKS_MAX;
+    
+    if (cmsGap == 0)
+        cmsGap = pTiming->cmsGap;
+    
+    keyboard_send_key_chord(hold.row, hold.columns[0], hold.columns[1],
                             nRow,
                             g_aKeyScans[nKey].columns[0],
-                            g_aKeyScans[nKey].columns[1]);
-}
\ No newline at end of file
+                            g_aKeyScans[nKey].columns[1],
+                            (cScans > KEYSTROKE_TICKS) ? cScans : KEYSTROKE_TICKS,
+                            cScans, cmsGap);
+}
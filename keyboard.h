@@ -10,6 +10,15 @@
 
 #include <stdint.h>
 
+//
+//  Timestamp queued key events, so the terminal can report how long a key
+//  took to reach the host; off by default, as it costs 34 bytes of RAM and a
+//  millisecond clock read per event.
+//
+#ifndef KEYBOARD_EVENT_TIMES
+# define KEYBOARD_EVENT_TIMES   0       // the host build can override this
+#endif
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -105,15 +114,45 @@ extern "C" {
 # error Too many keys defined in keyid_t enum!
 #endif
     
+    //
+    //  Classes of key, which share keystroke timings; see keymap.h.
+    //
+    typedef enum
+    {
+        KEYCLASS_PRINT = 0,     // prints a character and escapes
+        KEYCLASS_ESCAPE,        // only moves the carriage on or back
+        KEYCLASS_FEED,          // moves the paper
+        KEYCLASS_FUNCTION,      // margins, tabs, returns and shifts
+        
+        KEYCLASS_MAX
+    } keyclass_t;
+    
     typedef uint8_t keyevent_t;
     
     extern keyevent_t keyboard_get_next_event(void);
-    extern inline bit keyboard_is_down_event(const keyevent_t nEvent);
-    extern inline keyid_t keyboard_get_event_key(const keyevent_t nEvent);
+    extern uint16_t keyboard_get_event_ms(void);
+    extern uint16_t keyboard_get_scans_skipped(void);
+    extern bit keyboard_is_down_event(const keyevent_t nEvent);
+    extern keyid_t keyboard_get_event_key(const keyevent_t nEvent);
     
     extern void keyboard_send_balj(void);
     extern void keyboard_send_keystroke(keyid_t nKey);
     extern void keyboard_send_keychord(keyid_t nHoldKey, keyid_t nKey);
+    extern bit keyboard_send_keyhold(keyid_t nKey, uint8_t cTicks);
+    extern void keyboard_send_timed_keychord(keyid_t nHoldKey, keyid_t nKey,
+                                             uint8_t cScans, uint8_t cmsGap);
+    extern uint8_t keyboard_get_scans_in_ms(uint16_t cmsPeriod);
+    extern void keyboard_send_delay_ms(uint16_t cmsDelay);
+    extern uint8_t keyboard_get_queue_space(void);
+    extern bit keyboard_is_sending(void);
+    extern bit keyboard_is_typewriter_busy(void);
+    extern void keyboard_set_press_scans(keyclass_t nClass, uint8_t cScans);
+    extern uint8_t keyboard_get_press_scans(keyclass_t nClass);
+    extern void keyboard_set_gap_ms(keyclass_t nClass, uint8_t cmsGap);
+    extern uint8_t keyboard_get_gap_ms(keyclass_t nClass);
+    extern void keyboard_save_timings(void);
+    extern uint16_t keyboard_get_unverified(void);
+    extern bit keyboard_test_keypress(keyid_t nKey, uint8_t cScans);
 
 #ifdef	__cplusplus
 }
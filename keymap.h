@@ -0,0 +1,126 @@
+/* 
+ * File:   keymap.h
+ *
+ * The typewriter's key matrix, the ASCII character set and the classes of
+ * key, as key IDs.  These are the source for the lookups in keytables.h,
+ * which are generated from them at build time (see host/keytables.c) rather
+ * than at power-up.
+ */
+
+#ifndef KEYMAP_H
+#define	KEYMAP_H
+
+//
+//  Internal key IDs in the order of the bits that represent them in the raw
+//  scan data (bits 0->12 of rows 0->7).
+//
+#define KEYMAP_SCAN_IDS {                                \
+    /* row 0 */                                          \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,  \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_COLON, KEY_UNKNOWN,    \
+    KEY_UNKNOWN, KEY_TCLR, KEY_UNKNOWN, KEY_G, KEY_H,    \
+                                                         \
+    /* row 1 */                                          \
+    KEY_UNKNOWN, KEY_A, KEY_S, KEY_D,                    \
+    KEY_K, KEY_L, KEY_SEMICOLON, KEY_MAR_RTN,            \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_TSET, KEY_F, KEY_J,    \
+                                                         \
+    /* row 2 */                                          \
+    KEY_UNKNOWN, KEY_CENTS, KEY_UNKNOWN, KEY_UNKNOWN,    \
+    KEY_MU, KEY_UNKNOWN, KEY_DASH, KEY_BACKSPC,          \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_MAR_REL, KEY_5, KEY_6, \
+                                                         \
+    /* row 3 */                                          \
+    KEY_UNKNOWN, KEY_1, KEY_2, KEY_3,                    \
+    KEY_8, KEY_9, KEY_0, KEY_PAPER_UP,                   \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_4, KEY_7, \
+                                                         \
+    /* row 4 */                                          \
+    KEY_UNKNOWN, KEY_Q, KEY_W, KEY_E,                    \
+    KEY_I, KEY_O, KEY_P, KEY_PAPER_DOWN,                 \
+    KEY_UNKNOWN, KEY_LMAR, KEY_TAB, KEY_R, KEY_U,        \
+                                                         \
+    /* row 5 */                                          \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN,  \
+    KEY_BRACKETS, KEY_UNKNOWN, KEY_AT, KEY_UNKNOWN,      \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_RMAR, KEY_T, KEY_Y,    \
+                                                         \
+    /* row 6 */                                          \
+    KEY_UNKNOWN, KEY_Z, KEY_X, KEY_C,                    \
+    KEY_COMMA, KEY_FULLSTOP, KEY_INDICES, KEY_CRTN,      \
+    KEY_UNKNOWN, KEY_REPEAT, KEY_LOCK, KEY_V, KEY_M,     \
+                                                         \
+    /* row 7 */                                          \
+    KEY_SHIFT, KEY_ANGLES, KEY_UNKNOWN, KEY_UNKNOWN,     \
+    KEY_UNKNOWN, KEY_UNKNOWN, KEY_SLASH, KEY_LINESPACE,  \
+    KEY_CODE, KEY_SPACE, KEY_ERASE, KEY_B, KEY_N,        \
+}
+
+//
+//  The key (and whether it wants Shift) for each ASCII character.
+//
+#define KEYMAP_ASCII_KEYS {                                                                                              \
+    /* 00-03 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+    /* 04-07 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+    /* 08-0B */ KEY_BACKSPC, KEY_TAB, KEY_CRTN, KEY_NONE,                                                                \
+    /* 0C-0F */ KEY_NONE, KEY_CRTN, KEY_NONE, KEY_NONE,                                                                  \
+                                                                                                                         \
+    /* 10-13 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+    /* 14-17 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+    /* 18-1B */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+    /* 1C-1F */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE,                                                                  \
+                                                                                                                         \
+    /* 20-23 */ KEY_SPACE,              KEY_1 | KEY_SHIFTED,    KEY_2 | KEY_SHIFTED,        KEY_MU | KEY_SHIFTED,        \
+    /* 24-27 */ KEY_4 | KEY_SHIFTED,    KEY_5 | KEY_SHIFTED,    KEY_6 | KEY_SHIFTED,        KEY_7 | KEY_SHIFTED,         \
+    /* 28-2B */ KEY_8 | KEY_SHIFTED,    KEY_9 | KEY_SHIFTED,    KEY_COLON | KEY_SHIFTED,    KEY_SEMICOLON | KEY_SHIFTED, \
+    /* 2C-2F */ KEY_COMMA,              KEY_DASH,               KEY_FULLSTOP,               KEY_SLASH,                   \
+                                                                                                                         \
+    /* 30-33 */ KEY_0,      KEY_1,                  KEY_2,                      KEY_3,                                   \
+    /* 34-37 */ KEY_4,      KEY_5,                  KEY_6,                      KEY_7,                                   \
+    /* 38-3B */ KEY_8,      KEY_9,                  KEY_COLON,                  KEY_SEMICOLON,                           \
+    /* 3C-3F */ KEY_ANGLES, KEY_0 | KEY_SHIFTED,    KEY_ANGLES | KEY_SHIFTED,   KEY_SLASH | KEY_SHIFTED,                 \
+                                                                                                                         \
+    /* 40-43 */ KEY_AT, KEY_A | KEY_SHIFTED, KEY_B | KEY_SHIFTED, KEY_C | KEY_SHIFTED,                                   \
+    /* 44-47 */ KEY_D | KEY_SHIFTED,  KEY_E | KEY_SHIFTED, KEY_F | KEY_SHIFTED, KEY_G | KEY_SHIFTED,                     \
+    /* 48-4B */ KEY_H | KEY_SHIFTED,  KEY_I | KEY_SHIFTED, KEY_J | KEY_SHIFTED, KEY_K | KEY_SHIFTED,                     \
+    /* 4C-4F */ KEY_L | KEY_SHIFTED,  KEY_M | KEY_SHIFTED, KEY_N | KEY_SHIFTED, KEY_O | KEY_SHIFTED,                     \
+                                                                                                                         \
+    /* 50-53 */ KEY_P | KEY_SHIFTED, KEY_Q | KEY_SHIFTED, KEY_R | KEY_SHIFTED, KEY_S | KEY_SHIFTED,                      \
+    /* 54-57 */ KEY_T | KEY_SHIFTED, KEY_U | KEY_SHIFTED, KEY_V | KEY_SHIFTED, KEY_W | KEY_SHIFTED,                      \
+    /* 58-5B */ KEY_X | KEY_SHIFTED, KEY_Y | KEY_SHIFTED, KEY_Z | KEY_SHIFTED, KEY_BRACKETS | KEY_SHIFTED,               \
+    /* 5C-5F */ KEY_AT | KEY_SHIFTED, KEY_BRACKETS, KEY_CENTS | KEY_SHIFTED, KEY_DASH | KEY_SHIFTED,                     \
+                                                                                                                         \
+    /* 60-63 */ KEY_7 | KEY_SHIFTED, KEY_A, KEY_B, KEY_C,                                                                \
+    /* 64-67 */ KEY_D, KEY_E, KEY_F, KEY_G,                                                                              \
+    /* 68-6B */ KEY_H, KEY_I, KEY_J, KEY_K,                                                                              \
+    /* 6C-6F */ KEY_L, KEY_M, KEY_N, KEY_O,                                                                              \
+                                                                                                                         \
+    /* 70-73 */ KEY_P,  KEY_Q, KEY_R, KEY_S,                                                                             \
+    /* 74-77 */ KEY_T,  KEY_U, KEY_V, KEY_W,                                                                             \
+    /* 78-7B */ KEY_X,  KEY_Y, KEY_Z, KEY_BRACKETS | KEY_SHIFTED,                                                        \
+    /* 7C-7F */ KEY_MU, KEY_BRACKETS, KEY_CENTS, KEY_ERASE,                                                              \
+}
+
+//
+//  Characters that borrow another character's key because the typewriter
+//  has no key of their own; the key still types the character it belongs
+//  to.  Any other pair of characters sharing a key fails the build.
+//
+#define KEYMAP_ASCII_SUBSTITUTES    "\r`{}"
+
+//
+//  Keys that don't just print a character, by what they make the typewriter
+//  do; each class of key has its own press length and gap afterwards (see
+//  keyboard.c), and any key not listed here is KEYCLASS_PRINT.  A key listed
+//  twice fails the build.
+//
+#define KEYMAP_ESCAPE_KEYS      { KEY_SPACE, KEY_BACKSPC }
+
+#define KEYMAP_FEED_KEYS        { KEY_PAPER_UP, KEY_PAPER_DOWN, KEY_LINESPACE }
+
+#define KEYMAP_FUNCTION_KEYS    { KEY_MAR_REL, KEY_LMAR, KEY_RMAR,           \
+                                  KEY_TAB, KEY_TSET, KEY_TCLR,              \
+                                  KEY_CRTN, KEY_MAR_RTN, KEY_SHIFT,         \
+                                  KEY_LOCK, KEY_CODE, KEY_REPEAT }
+
+#endif	/* KEYMAP_H */
@@ -0,0 +1,126 @@
+/*
+ * File:   keytables.h
+ *
+ * Generated from keymap.h by host/keytables.c; do not edit.
+ */
+
+#ifndef KEYTABLES_H
+#define	KEYTABLES_H
+
+//
+//  Strobe row and column pins (active low) for each key ID.
+//
+#define KEYTABLE_SCANS {                                        \
+    /*   0 */ { 0xff, { 0xff, 0x3e } },                        \
+    /*   1 */ { 0xff, { 0xff, 0x3e } },                        \
+    /*   2 */ { 0xfb, { 0xff, 0x36 } },                        \
+    /*   3 */ { 0xfb, { 0xfd, 0x3e } },                        \
+    /*   4 */ { 0xf7, { 0xfd, 0x3e } },                        \
+    /*   5 */ { 0xf7, { 0xfb, 0x3e } },                        \
+    /*   6 */ { 0xf7, { 0xf7, 0x3e } },                        \
+    /*   7 */ { 0xf7, { 0xff, 0x2e } },                        \
+    /*   8 */ { 0xfb, { 0xff, 0x2e } },                        \
+    /*   9 */ { 0xfb, { 0xff, 0x1e } },                        \
+    /*  10 */ { 0xf7, { 0xff, 0x1e } },                        \
+    /*  11 */ { 0xf7, { 0xef, 0x3e } },                        \
+    /*  12 */ { 0xf7, { 0xdf, 0x3e } },                        \
+    /*  13 */ { 0xf7, { 0xbf, 0x3e } },                        \
+    /*  14 */ { 0xfb, { 0xbf, 0x3e } },                        \
+    /*  15 */ { 0xfb, { 0xef, 0x3e } },                        \
+    /*  16 */ { 0xfb, { 0x7f, 0x3e } },                        \
+    /*  17 */ { 0xf7, { 0x7f, 0x3e } },                        \
+    /*  18 */ { 0xef, { 0xff, 0x3a } },                        \
+    /*  19 */ { 0xef, { 0xff, 0x36 } },                        \
+    /*  20 */ { 0xef, { 0xfd, 0x3e } },                        \
+    /*  21 */ { 0xef, { 0xfb, 0x3e } },                        \
+    /*  22 */ { 0xef, { 0xf7, 0x3e } },                        \
+    /*  23 */ { 0xef, { 0xff, 0x2e } },                        \
+    /*  24 */ { 0xdf, { 0xff, 0x2e } },                        \
+    /*  25 */ { 0xdf, { 0xff, 0x1e } },                        \
+    /*  26 */ { 0xef, { 0xff, 0x1e } },                        \
+    /*  27 */ { 0xef, { 0xef, 0x3e } },                        \
+    /*  28 */ { 0xef, { 0xdf, 0x3e } },                        \
+    /*  29 */ { 0xef, { 0xbf, 0x3e } },                        \
+    /*  30 */ { 0xdf, { 0xbf, 0x3e } },                        \
+    /*  31 */ { 0xdf, { 0xef, 0x3e } },                        \
+    /*  32 */ { 0xbf, { 0x7f, 0x3e } },                        \
+    /*  33 */ { 0xef, { 0x7f, 0x3e } },                        \
+    /*  34 */ { 0xdf, { 0xff, 0x36 } },                        \
+    /*  35 */ { 0xbf, { 0xff, 0x36 } },                        \
+    /*  36 */ { 0xfd, { 0xfd, 0x3e } },                        \
+    /*  37 */ { 0xfd, { 0xfb, 0x3e } },                        \
+    /*  38 */ { 0xfd, { 0xf7, 0x3e } },                        \
+    /*  39 */ { 0xfd, { 0xff, 0x2e } },                        \
+    /*  40 */ { 0xfe, { 0xff, 0x2e } },                        \
+    /*  41 */ { 0xfe, { 0xff, 0x1e } },                        \
+    /*  42 */ { 0xfd, { 0xff, 0x1e } },                        \
+    /*  43 */ { 0xfd, { 0xef, 0x3e } },                        \
+    /*  44 */ { 0xfd, { 0xdf, 0x3e } },                        \
+    /*  45 */ { 0xfd, { 0xbf, 0x3e } },                        \
+    /*  46 */ { 0xfe, { 0xbf, 0x3e } },                        \
+    /*  47 */ { 0xbf, { 0xbf, 0x3e } },                        \
+    /*  48 */ { 0xfd, { 0x7f, 0x3e } },                        \
+    /*  49 */ { 0xfd, { 0xff, 0x36 } },                        \
+    /*  50 */ { 0x7f, { 0xfe, 0x3e } },                        \
+    /*  51 */ { 0x7f, { 0xfd, 0x3e } },                        \
+    /*  52 */ { 0xbf, { 0xfd, 0x3e } },                        \
+    /*  53 */ { 0xbf, { 0xfb, 0x3e } },                        \
+    /*  54 */ { 0xbf, { 0xf7, 0x3e } },                        \
+    /*  55 */ { 0xbf, { 0xff, 0x2e } },                        \
+    /*  56 */ { 0x7f, { 0xff, 0x2e } },                        \
+    /*  57 */ { 0x7f, { 0xff, 0x1e } },                        \
+    /*  58 */ { 0xbf, { 0xff, 0x1e } },                        \
+    /*  59 */ { 0xbf, { 0xef, 0x3e } },                        \
+    /*  60 */ { 0xbf, { 0xdf, 0x3e } },                        \
+    /*  61 */ { 0x7f, { 0xbf, 0x3e } },                        \
+    /*  62 */ { 0xbf, { 0xff, 0x3a } },                        \
+    /*  63 */ { 0xfe, { 0xff, 0x3a } },                        \
+    /*  64 */ { 0x7f, { 0xff, 0x3c } },                        \
+    /*  65 */ { 0x7f, { 0xff, 0x3a } },                        \
+    /*  66 */ { 0x7f, { 0xff, 0x36 } },                        \
+    /*  67 */ { 0x7f, { 0x7f, 0x3e } },                        \
+}
+
+//
+//  The character each key types, unshifted and then shifted.
+//
+#define KEYTABLE_CHARS {                                        \
+    /*   0 */ 0x00, 0x00, 0x00, 0x7e, 0x31, 0x32, 0x33, 0x34,   \
+    /*   8 */ 0x35, 0x36, 0x37, 0x38, 0x39, 0x30, 0x2d, 0x7c,   \
+    /*  16 */ 0x08, 0x00, 0x00, 0x09, 0x71, 0x77, 0x65, 0x72,   \
+    /*  24 */ 0x74, 0x79, 0x75, 0x69, 0x6f, 0x70, 0x40, 0x5d,   \
+    /*  32 */ 0x0a, 0x00, 0x00, 0x00, 0x61, 0x73, 0x64, 0x66,   \
+    /*  40 */ 0x67, 0x68, 0x6a, 0x6b, 0x6c, 0x3b, 0x3a, 0x00,   \
+    /*  48 */ 0x00, 0x00, 0x00, 0x3c, 0x7a, 0x78, 0x63, 0x76,   \
+    /*  56 */ 0x62, 0x6e, 0x6d, 0x2c, 0x2e, 0x2f, 0x00, 0x00,   \
+    /*  64 */ 0x00, 0x20, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /*  72 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /*  80 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /*  88 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /*  96 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /* 104 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /* 112 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /* 120 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   \
+    /* 128 */ 0x00, 0x00, 0x00, 0x5e, 0x21, 0x22, 0x00, 0x24,   \
+    /* 136 */ 0x25, 0x26, 0x27, 0x28, 0x29, 0x3d, 0x5f, 0x23,   \
+    /* 144 */ 0x00, 0x00, 0x00, 0x00, 0x51, 0x57, 0x45, 0x52,   \
+    /* 152 */ 0x54, 0x59, 0x55, 0x49, 0x4f, 0x50, 0x5c, 0x5b,   \
+    /* 160 */ 0x00, 0x00, 0x00, 0x00, 0x41, 0x53, 0x44, 0x46,   \
+    /* 168 */ 0x47, 0x48, 0x4a, 0x4b, 0x4c, 0x2b, 0x2a, 0x00,   \
+    /* 176 */ 0x00, 0x00, 0x00, 0x3e, 0x5a, 0x58, 0x43, 0x56,   \
+    /* 184 */ 0x42, 0x4e, 0x4d, 0x00, 0x00, 0x3f, 0x00, 0x00,   \
+    /* 192 */ 0x00, 0x00, 0x00, 0x00,                           \
+}
+
+//
+//  The class of each key (see keyclass_t).
+//
+#define KEYTABLE_CLASSES {                                      \
+    /*   0 */ 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   \
+    /*  16 */ 1, 2, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   \
+    /*  32 */ 3, 2, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,   \
+    /*  48 */ 3, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 3,   \
+    /*  64 */ 3, 1, 0, 2,                                       \
+}
+
+#endif	/* KEYTABLES_H */
@@ -39,7 +39,7 @@ void main_isr(void)
         uart_tx_isr();
     if (RCIF && RCIE)
         uart_rx_isr();
-    if (TMR0IF && TMR0IE)
+    if ((TMR0IF && TMR0IE) || (TMR1IF && TMR1IE))
         timers_isr();
 }
 
@@ -63,5 +63,7 @@ int main(int argc, char* argv[])
     {
         keyboard_update();
         terminal_process();
+        uart_update();
+        timers_idle();
     }
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <xc.h>
+#include "nv.h"
+
+//
+//  The High-Endurance Flash is the last 128 words of program memory, which
+//  on the 16K-word PIC16F1519 starts at 0x3f80; it's kept clear of code with
+//  the linker's --ROM option.  Only the low byte of each word is
+//  high-endurance, so that's all we use.  The settings row holds the record's
+//  length, the record, then a checksum over both, so that an erased or
+//  half-written row (or one saved by firmware with a different record) reads
+//  back as nothing at all.
+//
+#define NV_ROW_ADDRESS  0x3f80
+#define NV_ROW_WORDS    32
+
+#if NV_DATA_MAX + 2 > NV_ROW_WORDS
+# error Settings record is too big for a flash row.
+#endif
+
+static uint8_t nv_read(uint8_t idx)
+{
+    PMADRH = NV_ROW_ADDRESS >> 8;
+    PMADRL = (uint8_t) NV_ROW_ADDRESS + idx;
+    CFGS   = 0;
+    RD     = 1;
+    NOP();
+    NOP();
+    
+    return PMDATL;
+}
+
+//
+//  Kick off an erase or write with the unlock sequence, which mustn't be
+//  interrupted; the CPU then stalls (interrupts and all) until it's done.
+//
+static void nv_unlock(void)
+{
+    uint8_t bOldGIE = GIE;
+    
+    GIE    = 0;
+    PMCON2 = 0x55;
+    PMCON2 = 0xaa;
+    WR     = 1;
+    NOP();
+    NOP();
+    GIE    = bOldGIE;
+}
+
+//
+//  Read the settings record back into pData; returns false, leaving pData
+//  alone, if there's no valid record of cbData bytes.
+//
+bit nv_load(uint8_t *pData, uint8_t cbData)
+{
+    uint8_t nSum;
+    
+    if (cbData > NV_DATA_MAX || nv_read(0) != cbData)
+        return 0;
+    
+    nSum = cbData;
+    
+    for (uint8_t idx = 1; idx <= cbData; idx++)
+        nSum += nv_read(idx);
+    
+    if ((uint8_t) ~nSum != nv_read(cbData + 1))
+        return 0;
+    
+    for (uint8_t idx = 0; idx < cbData; idx++)
+        pData[idx] = nv_read(idx + 1);
+    
+    return 1;
+}
+
+//
+//  Erase the settings row and write the record to it, a word latch at a time
+//  with the row written along with the last one.  The erase and the write
+//  stall the CPU for a couple of milliseconds each, so this is best done
+//  while nothing's being typed.
+//
+void nv_save(const uint8_t *pData, uint8_t cbData)
+{
+    uint8_t nSum = cbData;
+    
+    if (cbData > NV_DATA_MAX)
+        return;
+    
+    PMADRH = NV_ROW_ADDRESS >> 8;
+    PMADRL = (uint8_t) NV_ROW_ADDRESS;
+    CFGS   = 0;
+    WREN   = 1;
+    FREE   = 1;
+    nv_unlock();
+    
+    FREE   = 0;
+    LWLO   = 1;
+    
+    for (uint8_t idx = 0; idx <= cbData + 1; idx++)
+    {
+        uint8_t nByte;
+        
+        if (idx == 0)
+        {
+            nByte = cbData;
+        }
+        else if (idx <= cbData)
+        {
+            nByte = pData[idx - 1];
+            nSum += nByte;
+        }
+        else
+        {
+            nByte = ~nSum;
+            LWLO  = 0;      // last word, so write the row
+        }
+        
+        PMADRL = (uint8_t) NV_ROW_ADDRESS + idx;
+        PMDATL = nByte;
+        PMDATH = 0;
+        nv_unlock();
+    }
+    
+    WREN = 0;
+}
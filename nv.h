@@ -0,0 +1,30 @@
+/* 
+ * File:   nv.h
+ *
+ * Settings kept in the PIC16F1519's High-Endurance Flash, since it has no
+ * data EEPROM.
+ */
+
+#ifndef NV_H
+#define	NV_H
+
+#include <stdint.h>
+
+//
+//  The settings record lives in one 32-word row, alongside its length and a
+//  checksum.
+//
+#define NV_DATA_MAX 30
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    extern bit  nv_load(uint8_t *pData, uint8_t cbData);
+    extern void nv_save(const uint8_t *pData, uint8_t cbData);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* NV_H */
@@ -0,0 +1,43 @@
+/*
+ * File:   profile.h
+ *
+ * Profiling probes marking what the firmware is waiting for.  These compile
+ * to nothing on the PIC; the host build uses them to attribute simulated
+ * time when benchmarking.
+ */
+
+#ifndef PROFILE_H
+#define	PROFILE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+    typedef enum
+    {
+        PROFILE_RUNNING = 0,    // not waiting on anything
+        PROFILE_IDLE,           // nothing to print
+        PROFILE_SCAN_SYNC,      // lining up with the typewriter's scan
+        PROFILE_KEYSTROKE,      // holding an injected key down
+        PROFILE_HOLDOFF,        // waiting out the holdoff timer...
+        PROFILE_GAP,            // ... after a keystroke
+        PROFILE_RETURN,         // ... after a carriage return
+
+        PROFILE_MAX
+    } profile_wait_t;
+
+#ifdef HOST_BUILD
+# define profile_wait(nWait)            host_profile_wait(nWait)
+# define profile_holdoff(nWhy, cms)     host_profile_holdoff(nWhy, cms)
+# define profile_holdoff_cancel()       host_profile_holdoff_cancel()
+#else
+# define profile_wait(nWait)
+# define profile_holdoff(nWhy, cms)
+# define profile_holdoff_cancel()
+#endif
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* PROFILE_H */
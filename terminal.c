@@ -2,80 +2,184 @@
 #include <stdio.h>
 #include "terminal.h"
 #include "keyboard.h"
+#include "keymap.h"
+#include "keytables.h"
 #include "uart.h"
 #include "timers.h"
 #include "leds.h"
 
-#define RETURN_DELAY        1000
 #define TYPEMATIC_INTERVAL  77
 #define TYPEMATIC_DELAY     400
 
 //
-//  'X-units per inch'; we use 120 because 10/12/15cpi all evenly divide it,
-//  even for half-character widths (for the half-backspace key or centred text)
+//  Worst case for one character: Shift, the key, then Lock again if we have
+//  to type a lower-case letter while shift-locked.
 //
-#define XPI                     120
-#define POWERUP_CPI             10
-#define POWERUP_LEFT_MARGIN     10
-#define POWERUP_RIGHT_MARGIN    75
-#define MARGIN_BELL_CHARS       8
+#define KEYSTROKES_PER_CHAR 3
 
-static const keyid_t g_aAsciiKeys[128] = {
-    
-    /* 00-03 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
-    /* 04-07 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
-    /* 08-0B */ KEY_BACKSPC, KEY_TAB, KEY_CRTN, KEY_NONE, 
-    /* 0C-0F */ KEY_NONE, KEY_CRTN, KEY_NONE, KEY_NONE, 
+//
+//  Shortest run of shifted characters worth engaging Lock for, rather than
+//  chording each one with Shift: a chord only holds Shift for five extra
+//  scans, but Lock costs two whole keystrokes and their gaps (Lock itself,
+//  and Shift to release it again afterwards).
+//
+#define LOCK_RUN_SHIFTED    7
 
-    /* 10-13 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
-    /* 14-17 */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
-    /* 18-1B */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
-    /* 1C-1F */ KEY_NONE, KEY_NONE, KEY_NONE, KEY_NONE, 
+//
+//  ... and the shortest run of unshifted characters worth releasing Lock for;
+//  typing one under Lock takes a Shift before it and a Lock after it anyway.
+//
+#define LOCK_RUN_UNSHIFTED  2
 
-    /* 20-23 */ KEY_SPACE,              KEY_1 | KEY_SHIFTED,    KEY_2 | KEY_SHIFTED,        KEY_MU | KEY_SHIFTED, 
-    /* 24-27 */ KEY_4 | KEY_SHIFTED,    KEY_5 | KEY_SHIFTED,    KEY_6 | KEY_SHIFTED,        KEY_7 | KEY_SHIFTED, 
-    /* 28-2B */ KEY_8 | KEY_SHIFTED,    KEY_9 | KEY_SHIFTED,    KEY_COLON | KEY_SHIFTED,    KEY_SEMICOLON | KEY_SHIFTED, 
-    /* 2C-2F */ KEY_COMMA,              KEY_DASH,               KEY_FULLSTOP,               KEY_SLASH, 
+//
+//  Runs of the same character are left to the Repeat key's typematic: it
+//  types the last character again as soon as it registers, then once every
+//  TYPEMATIC_INTERVAL for as long as it's held.  The two scans before it
+//  registers are added on to the hold, and the release is aimed mid-way
+//  between two repeats so that scan jitter can't gain or lose a character.
+//  It's not worth it for a single repeat, which is just another keystroke,
+//  and the run is capped so that the carriage model doesn't get too far
+//  ahead of the typewriter.
+//
+#define REPEAT_RUN_MIN      2
+#define REPEAT_RUN_MAX      16
+#define REPEAT_SCANS_BEFORE 2
 
-    /* 30-33 */ KEY_0,      KEY_1,                  KEY_2,                      KEY_3, 
-    /* 34-37 */ KEY_4,      KEY_5,                  KEY_6,                      KEY_7, 
-    /* 38-3B */ KEY_8,      KEY_9,                  KEY_COLON,                  KEY_SEMICOLON, 
-    /* 3C-3F */ KEY_ANGLES, KEY_0 | KEY_SHIFTED,    KEY_ANGLES | KEY_SHIFTED,   KEY_SLASH | KEY_SHIFTED, 
+//
+//  Rough costs, in milliseconds, for picking the quickest way to move the
+//  carriage to a column: a keystroke and the gap after it, plus the extra
+//  holdoff the typewriter needs to tab across each column or to feed the
+//  paper back down a line.
+//
+#define MS_PER_KEYSTROKE    80
+#define MS_PER_TAB_COLUMN   5
+#define FEED_DELAY          30
 
-    /* 40-43 */ KEY_AT, KEY_A | KEY_SHIFTED, KEY_B | KEY_SHIFTED, KEY_C | KEY_SHIFTED, 
-    /* 44-47 */ KEY_D | KEY_SHIFTED,  KEY_E | KEY_SHIFTED, KEY_F | KEY_SHIFTED, KEY_G | KEY_SHIFTED, 
-    /* 48-4B */ KEY_H | KEY_SHIFTED,  KEY_I | KEY_SHIFTED, KEY_J | KEY_SHIFTED, KEY_K | KEY_SHIFTED, 
-    /* 4C-4F */ KEY_L | KEY_SHIFTED,  KEY_M | KEY_SHIFTED, KEY_N | KEY_SHIFTED, KEY_O | KEY_SHIFTED, 
+//
+//  Lines on a page (11" at 6 lines per inch), for form feeds.
+//
+#define PAGE_LINES          66
 
-    /* 50-53 */ KEY_P | KEY_SHIFTED, KEY_Q | KEY_SHIFTED, KEY_R | KEY_SHIFTED, KEY_S | KEY_SHIFTED, 
-    /* 54-57 */ KEY_T | KEY_SHIFTED, KEY_U | KEY_SHIFTED, KEY_V | KEY_SHIFTED, KEY_W | KEY_SHIFTED, 
-    /* 58-5B */ KEY_X | KEY_SHIFTED, KEY_Y | KEY_SHIFTED, KEY_Z | KEY_SHIFTED, KEY_BRACKETS | KEY_SHIFTED, 
-    /* 5C-5F */ KEY_AT | KEY_SHIFTED, KEY_BRACKETS, KEY_CENTS | KEY_SHIFTED, KEY_DASH | KEY_SHIFTED, 
+//
+//  The host expects tab stops every eight columns from the left margin; the
+//  typewriter's own stops are wherever they've been set.
+//
+#define HOST_TAB_COLUMNS    8
+#define TAB_STOPS_MAX       16
+
+//
+//  When learning tab stops (toggled with Code-L), a column where text starts
+//  after a gap of at least TAB_LEARN_GAP characters is a candidate stop, and
+//  once TAB_LEARN_HITS lines have started text there we set a stop on it.
+//  Only the last TAB_CANDIDATES candidates are remembered.  We can't tell
+//  what stops were set on the typewriter before power-up, so they should be
+//  cleared before learning's turned on, or a Tab could stop short at one.
+//
+#define TAB_LEARN_GAP       2
+#define TAB_LEARN_HITS      2
+#define TAB_CANDIDATES      8
 
-    /* 60-63 */ KEY_7 | KEY_SHIFTED, KEY_A, KEY_B, KEY_C, 
-    /* 64-67 */ KEY_D, KEY_E, KEY_F, KEY_G, 
-    /* 68-6B */ KEY_H, KEY_I, KEY_J, KEY_K, 
-    /* 6C-6F */ KEY_L, KEY_M, KEY_N, KEY_O, 
+//
+//  Code-K calibrates the keystroke press length: CALIBRATE_KEYS test
+//  keystrokes for each length from one scan up to CALIBRATE_SCANS_MAX, and
+//  the first length the typewriter takes every one of (plus CALIBRATE_MARGIN)
+//  is the one used for every class of key from then on.
+//
+#define CALIBRATE_KEYS      4
+#define CALIBRATE_SCANS_MAX 9
+#define CALIBRATE_MARGIN    1
 
-    /* 70-73 */ KEY_P,  KEY_Q, KEY_R, KEY_S, 
-    /* 74-77 */ KEY_T,  KEY_U, KEY_V, KEY_W, 
-    /* 78-7B */ KEY_X,  KEY_Y, KEY_Z, KEY_BRACKETS | KEY_SHIFTED, 
-    /* 7C-7F */ KEY_MU, KEY_BRACKETS, KEY_CENTS, KEY_ERASE, 
+//
+//  The host can tune each class of key's timing (see keyboard.h) with
+//  ESC [ class ; press ; gap k, the press length in scans and the gap after
+//  it in milliseconds; a press length of zero, or leaving either off the end,
+//  leaves it as it was.  The class's timing is reported back in the same
+//  form, as it is for ESC [ class k on its own, and saved to flash once
+//  there's nothing left to type and the host has stopped sending.  Other
+//  escape sequences are swallowed.
+//
+#define ESCAPE_PARAMS_MAX   3
 
+//
+//  ESC [ 5 n asks for a status report, which comes back as
+//  ESC [ 0 ; n ; n ; n ; n ; n n with how long the last byte we timed
+//  through the receive buffer waited to be typed, in milliseconds, how many
+//  bytes we've had to drop for want of room to send them, how many keyboard
+//  scans the main loop was too busy to look at, how many keystrokes were let
+//  go before they'd been read back for long enough, and how long the last
+//  key typed took to go to the host, in milliseconds (always 0 unless
+//  KEYBOARD_EVENT_TIMES is set; see keyboard.h).
+//
+#define STATUS_REQUEST      5
+
+//
+//  ESC [ n z hands the keyboard straight to the host, for a print server that
+//  plans its own keystrokes: each byte from 0x80 up types the key whose
+//  keyid_t (see keyboard.h) is the rest of the byte.  Before it, '+' and a
+//  key byte chord it with that key held down, 'P' holds it for a number of
+//  scans and 'G' leaves a gap of a number of milliseconds after it (zero for
+//  its class's timing); 'W' waits a number of tens of milliseconds after the
+//  last key.  Each number is one byte, 0x20 more than its value, so nothing
+//  in the stream is a NUL or XON/XOFF; a prefix followed by anything else is
+//  ignored.  ESC goes back to ASCII, starting an escape sequence there, so
+//  ESC [ 5 n still asks for a status report.  If n isn't zero, an ACK goes
+//  back every time another n keystrokes have been queued.
+//  The carriage is tracked as usual, except across Code chords.
+//
+#define DIRECT_NUMBER_BASE  0x20
+#define DIRECT_WAIT_MS      10
+#define ACK                 0x06
+
+//
+//  'X-units per inch'; we use 120 because 10/12/15cpi all evenly divide it,
+//  even for half-character widths (for the half-backspace key or centred text)
+//
+#define XPI                     120
+#define POWERUP_CPI             10
+#define POWERUP_LEFT_MARGIN     10
+#define POWERUP_RIGHT_MARGIN    75
+#define MARGIN_BELL_CHARS       8
+#ifndef POWERUP_LEARN_TABS
+# define POWERUP_LEARN_TABS     0       // the host build can override this
+#endif
+
+//
+//  Holdoff after a carriage return, indexed by the distance the carriage has
+//  to travel back to the left margin in whole inches (rounded up); this is a
+//  settling time for the line feed plus the travel itself, capped at the
+//  full second that used to be allowed for every return.  Recalibrate here if
+//  keystrokes are lost after returns from long lines.
+//
+static const uint16_t g_acmsReturnDelay[] = {
+    /* 0-3"  */ 200,  315,  430,  545,
+    /* 4-7"  */ 660,  775,  890,  1000,
+    /* 8-11" */ 1000, 1000, 1000, 1000,
 };
 
-static char g_achKeys[KEY_MAX | KEY_SHIFTED] = { 0 };
+//
+//  The key for each ASCII character (see keymap.h), and the character each
+//  key types, as generated into keytables.h.
+//
+static const keyid_t g_aAsciiKeys[128] = KEYMAP_ASCII_KEYS;
+
+static const char g_achKeys[KEY_MAX | KEY_SHIFTED] = KEYTABLE_CHARS;
 
 static bit g_bIsLocked   = 0;
 static bit g_bIsLockDown = 0;
+static bit g_bLockMoved  = 0;     // we've changed Lock from how the user left it
 static bit g_bIsShifted  = 0;
 static bit g_bIsCode     = 0;
 static bit g_bCodePress  = 0;
 static bit g_bSendCtrl   = 0;
 static bit g_bRepeating  = 0;
+static bit g_bCalibrate  = 0;
+static bit g_bSaveTimings = 0;
+static bit g_bDirect     = 0;
 
 static char g_chPending  = 0;
+static char g_chMoveNext = 0;     // to print once the carriage gets there
 static char g_chRepeat   = 0;
+static uint16_t g_msKeyLatency = 0;     // from key event to serial port
 
 static uint8_t  g_cxCharacter   =                            XPI  / POWERUP_CPI;
 static uint16_t g_cxPosition    = (POWERUP_LEFT_MARGIN     * XPI) / POWERUP_CPI;
@@ -84,159 +188,1035 @@ static uint16_t g_cxRightMargin = (POWERUP_RIGHT_MARGIN    * XPI) / POWERUP_CPI;
 static uint16_t g_cxBell        = ((POWERUP_RIGHT_MARGIN - MARGIN_BELL_CHARS)
                                                            * XPI) / POWERUP_CPI;
 static bit      g_bAutoReturn   = 0;
+static uint8_t  g_nPageLine     = 0;            // lines fed since top of form
+static uint8_t  g_cFeedsPending = 0;
+static uint16_t g_cxTarget      = 0;            // where host motion has left off
+static bit      g_bMovePending  = 0;            // ... if the carriage isn't there
+
+static uint16_t g_acxTabStops[TAB_STOPS_MAX];   // known stops, ascending
+static uint8_t  g_cTabStops     = 0;
+static bit      g_bLearnTabs    = POWERUP_LEARN_TABS;
+
+static uint16_t g_acxCandidates[TAB_CANDIDATES];
+static uint8_t  g_acCandidateHits[TAB_CANDIDATES];
+static uint8_t  g_idxCandidate  = 0;            // next one to replace
+
+static void terminal_auto_return_toggled(void)
+{
+    g_bAutoReturn ^= 1;
+}
+
+static void terminal_learn_tabs_toggled(void)
+{
+    g_bLearnTabs ^= 1;
+}
+
+static void terminal_pitch_cycled(void)
+{
+    switch (g_cxCharacter)
+    {
+        case XPI / 10:
+            g_cxCharacter  = XPI / 12;
+            break;
+            
+        case XPI / 12:
+            g_cxCharacter  = XPI / 15;
+            break;
+            
+        case XPI / 15:
+        default:
+            g_cxCharacter  = XPI / 10;
+            break;
+    }
+    
+    g_cxBell = g_cxRightMargin - (MARGIN_BELL_CHARS * g_cxCharacter);
+}
+
+static uint16_t terminal_get_return_delay_ms(void)
+{
+    uint16_t cxTravel = 0;
+    uint8_t  idxDelay;
+
+    if (g_cxPosition > g_cxLeftMargin)
+    {
+        cxTravel = g_cxPosition - g_cxLeftMargin;
+    }
+
+    //
+    //  Mixed pitches can leave the carriage a little past 11", so clamp.
+    //
+    idxDelay = (cxTravel + XPI - 1) / XPI;
+    
+    if (idxDelay >= sizeof(g_acmsReturnDelay) / sizeof(g_acmsReturnDelay[0]))
+        idxDelay = sizeof(g_acmsReturnDelay) / sizeof(g_acmsReturnDelay[0]) - 1;
+
+    return g_acmsReturnDelay[idxDelay];
+}
+
+static void terminal_paper_fed(int8_t cLines)
+{
+    g_nPageLine = (g_nPageLine + PAGE_LINES + cLines) % PAGE_LINES;
+}
+
+static void terminal_carriage_returned(void)
+{
+    keyboard_send_delay_ms(terminal_get_return_delay_ms());
+
+    g_cxPosition = g_cxLeftMargin;
+    terminal_paper_fed(1);
+}
+
+static uint8_t terminal_find_tab_stop(uint16_t cx)
+{
+    uint8_t idx = 0;
+    
+    while (idx < g_cTabStops && g_acxTabStops[idx] < cx)
+        idx++;
+    
+    return idx;
+}
+
+static void terminal_tab_set(void)
+{
+    uint8_t idx = terminal_find_tab_stop(g_cxPosition);
+    
+    if (g_cTabStops >= TAB_STOPS_MAX ||
+        (idx < g_cTabStops && g_acxTabStops[idx] == g_cxPosition))
+    {
+        return;
+    }
+    
+    for (uint8_t idxMove = g_cTabStops; idxMove > idx; idxMove--)
+        g_acxTabStops[idxMove] = g_acxTabStops[idxMove - 1];
+    
+    g_acxTabStops[idx] = g_cxPosition;
+    g_cTabStops++;
+}
+
+static void terminal_tab_cleared(void)
+{
+    uint8_t idx = terminal_find_tab_stop(g_cxPosition);
+    
+    if (idx >= g_cTabStops || g_acxTabStops[idx] != g_cxPosition)
+        return;
+    
+    g_cTabStops--;
+    
+    for (; idx < g_cTabStops; idx++)
+        g_acxTabStops[idx] = g_acxTabStops[idx + 1];
+}
 
-static void terminal_init_ascii_table(void)
+//
+//  Where the Tab key takes the carriage from cxFrom: the next stop we know
+//  of, or the right margin if there isn't one.
+//
+static uint16_t terminal_next_tab_stop(uint16_t cxFrom)
 {
-    for (char ch = 0; ch < 128; ch++)
+    for (uint8_t idx = 0; idx < g_cTabStops; idx++)
+    {
+        if (g_acxTabStops[idx] >= g_cxRightMargin)
+            break;
+        
+        if (g_acxTabStops[idx] > cxFrom)
+            return g_acxTabStops[idx];
+    }
+    
+    return g_cxRightMargin;
+}
+
+static void terminal_char_printed(uint8_t bCanBreak)
+{
+    if (g_cxPosition < (11 * XPI))
+    {
+        g_cxPosition += g_cxCharacter;
+    }
+
+    //
+    //  Will the typewriter have inserted an automatic return here?
+    //
+    if (bCanBreak && g_bAutoReturn && g_cxPosition > g_cxBell)
+    {
+        terminal_carriage_returned();
+    }
+}
+
+static void terminal_handle_motion(keyid_t nKey)
+{
+    switch (nKey)
+    {
+        case KEY_BACKSPC:
+        case KEY_ERASE:
+            if (g_cxPosition > g_cxLeftMargin)
+            {
+                g_cxPosition -= g_cxCharacter;
+            }
+            break;
+            
+        case KEY_CRTN:
+        case KEY_MAR_RTN:
+            terminal_carriage_returned();
+            break;
+            
+        case KEY_MAR_REL:
+            g_cxLeftMargin = 0;
+            break;
+            
+        case KEY_LMAR:
+            g_cxLeftMargin = g_cxPosition;
+            break;
+            
+        case KEY_RMAR:
+            g_cxRightMargin = g_cxPosition;
+            g_cxBell = g_cxRightMargin - (MARGIN_BELL_CHARS * g_cxCharacter);
+            break;
+            
+        case KEY_TSET:
+            terminal_tab_set();
+            break;
+            
+        case KEY_TCLR:
+            terminal_tab_cleared();
+            break;
+            
+        case KEY_PAPER_UP:
+        case KEY_LINESPACE:
+            terminal_paper_fed(1);
+            break;
+            
+        case KEY_PAPER_DOWN:
+            terminal_paper_fed(-1);
+            break;
+            
+        case KEY_TAB:
+            if (g_cxPosition < g_cxRightMargin)
+            {
+                g_cxPosition = terminal_next_tab_stop(g_cxPosition);
+            }
+            break;
+            
+        case KEY_SPACE:
+        case KEY_DASH:
+            terminal_char_printed(1);
+            break;
+            
+        default:
+            terminal_char_printed(0);
+            break;
+    }
+}
+
+//
+//  Keys that do the same thing whether or not the typewriter is shifted.
+//
+static bit terminal_is_shift_neutral(keyid_t nKey)
+{
+    switch (nKey)
+    {
+        case KEY_SPACE:
+        case KEY_TAB:
+        case KEY_BACKSPC:
+        case KEY_CRTN:
+            return 1;
+    }
+    
+    return 0;
+}
+
+//
+//  Look ahead through the received data for how many of the following
+//  characters want the typewriter shifted (or not, per bShifted) before one
+//  wants the opposite; shift-neutral characters are skipped over, and there's
+//  no need to count further than cMax.
+//
+static uint8_t terminal_count_shift_run(uint8_t bShifted, uint8_t cMax)
+{
+    uint8_t cRun = 0;
+    uint8_t idx  = 0;
+    char    ch;
+    
+    while (cRun < cMax && (ch = uart_peek_rx_byte(idx++)) != 0)
+    {
+        keyid_t nKey = (ch < 128) ? g_aAsciiKeys[ch] : KEY_NONE;
+        
+        if (nKey == KEY_NONE || terminal_is_shift_neutral(nKey))
+            continue;
+        
+        if (((nKey & KEY_SHIFTED) != 0) != bShifted)
+            break;
+        
+        cRun++;
+    }
+    
+    return cRun;
+}
+
+//
+//  Engage or release Lock for a run of characters; it gets put back the way
+//  the user left it once we run out of things to type.
+//
+static void terminal_toggle_lock(void)
+{
+    keyboard_send_keystroke(g_bIsLocked ? KEY_SHIFT : KEY_LOCK);
+    
+    g_bIsLocked ^= 1;
+    g_bLockMoved ^= 1;
+}
+
+static void terminal_inject_ascii(char ch)
+{
+    keyid_t nKey = (ch < 128) ? g_aAsciiKeys[ch] : KEY_NONE;
+    
+    if (nKey == KEY_NONE)
+        return;
+    
+    if (terminal_is_shift_neutral(nKey))
+    {
+        keyboard_send_keystroke(nKey);
+    }
+    else if (nKey & KEY_SHIFTED)
+    {
+        if (g_bIsShifted || g_bIsLocked)
+        {
+            keyboard_send_keystroke(nKey & ~KEY_SHIFTED);
+        }
+        else if (terminal_count_shift_run(1, LOCK_RUN_SHIFTED - 1)
+                                          == LOCK_RUN_SHIFTED - 1)
+        {
+            terminal_toggle_lock();
+            keyboard_send_keystroke(nKey & ~KEY_SHIFTED);
+        }
+        else
+        {
+            keyboard_send_keychord(KEY_SHIFT, nKey & ~KEY_SHIFTED);
+        }
+    }
+    else
+    {
+        if (g_bIsLocked &&
+            terminal_count_shift_run(0, LOCK_RUN_UNSHIFTED - 1)
+                                     == LOCK_RUN_UNSHIFTED - 1)
+        {
+            terminal_toggle_lock();
+            keyboard_send_keystroke(nKey);
+        }
+        else if (g_bIsLocked)
+        {
+            keyboard_send_keystroke(KEY_SHIFT);
+            keyboard_send_keystroke(nKey);
+            keyboard_send_keystroke(KEY_LOCK);
+        }
+        else if (g_bIsShifted)
+        {
+            //
+            //  Wait for the user to release the Shift key before continuing.
+            //
+            g_chPending = ch;
+            return;
+        }
+        else
+        {
+            keyboard_send_keystroke(nKey);
+        }
+    }
+    
+    terminal_handle_motion(nKey & ~KEY_SHIFTED);
+}
+
+//
+//  Hold the Repeat key to type ch another cRepeats times, having just typed
+//  it; returns how many it'll actually type, which is 0 if the run's too
+//  short to be worth it.  The carriage model is updated to match.
+//
+static uint8_t terminal_send_repeats(char ch, uint8_t cRepeats)
+{
+    uint8_t cTicks;
+    
+    if (g_bAutoReturn || cRepeats < REPEAT_RUN_MIN ||
+        keyboard_get_queue_space() == 0)
+    {
+        //
+        //  The typewriter might throw in an automatic return part-way through
+        //  the run, or there's no point, or no room to send the keystroke.
+        //
+        return 0;
+    }
+    
+    if (cRepeats > REPEAT_RUN_MAX)
+        cRepeats = REPEAT_RUN_MAX;
+    
+    //
+    //  If the typewriter's scanning quickly, the hold for a long run might not
+    //  fit in a keystroke's tick count; shorten the run until it does.
+    //
+    while ((cTicks = keyboard_get_scans_in_ms(((2 * cRepeats - 1)
+                                   * TYPEMATIC_INTERVAL) / 2))
+                      > 0xff - REPEAT_SCANS_BEFORE)
+    {
+        if (--cRepeats < REPEAT_RUN_MIN)
+            return 0;
+    }
+    
+    if (cTicks == 0)
+        return 0;   // don't know the scan rate yet
+    
+    if (! keyboard_send_keyhold(KEY_REPEAT, REPEAT_SCANS_BEFORE + cTicks))
+        return 0;   // too short a hold to be any use; type them one by one
+    
+    for (uint8_t idx = 0; idx < cRepeats; idx++)
+        terminal_handle_motion(g_aAsciiKeys[ch] & ~KEY_SHIFTED);
+    
+    return cRepeats;
+}
+
+//
+//  Having just typed ch, let the Repeat key type any more of it that follow
+//  in the received data.
+//
+static void terminal_inject_repeats(char ch)
+{
+    uint8_t cRepeats = 0;
+    
+    if (ch < ' ' || ch >= 127 || g_chPending)
+        return;     // not a printing character, or it didn't get typed
+    
+    while (cRepeats < REPEAT_RUN_MAX && uart_peek_rx_byte(cRepeats) == ch)
+        cRepeats++;
+    
+    cRepeats = terminal_send_repeats(ch, cRepeats);
+    
+    while (cRepeats--)
+        uart_get_rx_byte();
+}
+
+//
+//  Where the host's control of the carriage with ch leaves it, if it's one of
+//  the characters that moves it without printing anything; chNext is what
+//  follows, to tell a return to the start of the line apart from a newline.
+//
+static bit terminal_apply_motion(char ch, char chNext, uint16_t *pcx)
+{
+    uint16_t nColumn;
+    
+    switch (ch)
+    {
+        case ' ':
+            *pcx += g_cxCharacter;
+            return 1;
+            
+        case '\t':
+            nColumn = (*pcx > g_cxLeftMargin) ?
+                      (*pcx - g_cxLeftMargin) / g_cxCharacter : 0;
+            nColumn = (nColumn / HOST_TAB_COLUMNS + 1) * HOST_TAB_COLUMNS;
+            
+            *pcx = g_cxLeftMargin + nColumn * g_cxCharacter;
+            
+            if (*pcx > g_cxRightMargin)
+                *pcx = g_cxRightMargin;
+            return 1;
+            
+        case '\b':
+            if (*pcx > g_cxLeftMargin)
+                *pcx -= g_cxCharacter;
+            return 1;
+            
+        case '\r':
+            if (chNext == 0 || chNext == '\n')
+                return 0;   // a newline, or might be
+            
+            *pcx = g_cxLeftMargin;
+            return 1;
+    }
+    
+    return 0;
+}
+
+static uint16_t terminal_spaces_cost(uint16_t cxFrom, uint16_t cxTo)
+{
+    return ((cxTo - cxFrom) / g_cxCharacter) * MS_PER_KEYSTROKE;
+}
+
+static uint16_t terminal_tab_cost(uint16_t cxFrom, uint16_t cxTo)
+{
+    return MS_PER_KEYSTROKE +
+           ((cxTo - cxFrom) / g_cxCharacter) * MS_PER_TAB_COLUMN;
+}
+
+//
+//  Cost of moving the carriage forward from cxFrom to cxTo, tabbing to each
+//  stop on the way that it's quicker to tab to than space to.
+//
+static uint16_t terminal_forward_cost(uint16_t cxFrom, uint16_t cxTo)
+{
+    uint16_t cms = 0;
+    uint16_t cxStop;
+    
+    while ((cxStop = terminal_next_tab_stop(cxFrom)) <= cxTo && cxStop > cxFrom)
+    {
+        uint16_t cmsTab    = terminal_tab_cost(cxFrom, cxStop);
+        uint16_t cmsSpaces = terminal_spaces_cost(cxFrom, cxStop);
+        
+        cms   += (cmsTab < cmsSpaces) ? cmsTab : cmsSpaces;
+        cxFrom = cxStop;
+    }
+    
+    return cms + terminal_spaces_cost(cxFrom, cxTo);
+}
+
+//
+//  The carriage motion below only queues as many keystrokes as there's room
+//  for, so as not to hold up the main loop waiting for the keyboard driver;
+//  each returns whether the carriage has got there yet, and is called again
+//  next time round if not.
+//
+static bit terminal_send_spaces(uint16_t cxTo)
+{
+    uint8_t cSpaces;
+    
+    if (cxTo <= g_cxPosition)
+        return 1;
+    
+    cSpaces = (cxTo - g_cxPosition) / g_cxCharacter;
+    
+    while (cSpaces && keyboard_get_queue_space() != 0)
+    {
+        keyboard_send_keystroke(KEY_SPACE);
+        terminal_handle_motion(KEY_SPACE);
+        cSpaces--;
+        
+        cSpaces -= terminal_send_repeats(' ', cSpaces);
+    }
+    
+    return cSpaces == 0;
+}
+
+//
+//  Move the carriage forward to cxTo, following the same route that
+//  terminal_forward_cost() costed.
+//
+static bit terminal_move_forward(uint16_t cxTo)
+{
+    uint16_t cxStop;
+    
+    while ((cxStop = terminal_next_tab_stop(g_cxPosition)) <= cxTo &&
+           cxStop > g_cxPosition)
+    {
+        if (terminal_tab_cost(g_cxPosition, cxStop) <
+            terminal_spaces_cost(g_cxPosition, cxStop))
+        {
+            if (keyboard_get_queue_space() == 0)
+                return 0;
+            
+            keyboard_send_keystroke(KEY_TAB);
+            keyboard_send_delay_ms(((cxStop - g_cxPosition) / g_cxCharacter)
+                                   * MS_PER_TAB_COLUMN);
+            terminal_handle_motion(KEY_TAB);
+        }
+        else if (! terminal_send_spaces(cxStop))
+        {
+            return 0;
+        }
+    }
+    
+    return terminal_send_spaces(cxTo);
+}
+
+//
+//  Get the carriage to cxTarget on the current line by whichever's quickest:
+//  backspacing, or returning and feeding the paper back down before moving
+//  forward again, for going backwards; spacing or tabbing for going forwards.
+//
+static bit terminal_move_to(uint16_t cxTarget)
+{
+    if (cxTarget < g_cxPosition)
+    {
+        uint16_t cmsBack   = terminal_spaces_cost(cxTarget, g_cxPosition);
+        uint16_t cmsReturn = 2 * MS_PER_KEYSTROKE + FEED_DELAY
+                           + terminal_get_return_delay_ms()
+                           + terminal_forward_cost(g_cxLeftMargin, cxTarget);
+        
+        if (cmsReturn < cmsBack && cxTarget >= g_cxLeftMargin)
+        {
+            if (keyboard_get_queue_space() < 2)
+                return 0;   // don't return without feeding back again
+            
+            keyboard_send_keystroke(KEY_CRTN);
+            terminal_handle_motion(KEY_CRTN);
+            
+            keyboard_send_keystroke(KEY_PAPER_DOWN);
+            terminal_handle_motion(KEY_PAPER_DOWN);
+        }
+        else
+        {
+            while (g_cxPosition >= cxTarget + g_cxCharacter &&
+                   g_cxPosition > g_cxLeftMargin)
+            {
+                if (keyboard_get_queue_space() == 0)
+                    return 0;
+                
+                keyboard_send_keystroke(KEY_BACKSPC);
+                terminal_handle_motion(KEY_BACKSPC);
+            }
+        }
+    }
+    
+    return terminal_move_forward(cxTarget);
+}
+
+//
+//  Text is about to start at the carriage position after a gap; if it's
+//  started here often enough, set a tab stop so the next line can tab here.
+//
+static void terminal_learn_tab_stop(void)
+{
+    uint8_t idx;
+    
+    if (g_cTabStops >= TAB_STOPS_MAX ||
+        terminal_next_tab_stop(g_cxPosition - 1) == g_cxPosition)
+    {
+        return;     // no room for more, or there's already a stop here
+    }
+    
+    for (idx = 0; idx < TAB_CANDIDATES; idx++)
+    {
+        if (g_acCandidateHits[idx] && g_acxCandidates[idx] == g_cxPosition)
+            break;
+    }
+    
+    if (idx == TAB_CANDIDATES)
+    {
+        idx = g_idxCandidate;
+        g_idxCandidate = (idx + 1) % TAB_CANDIDATES;
+        
+        g_acxCandidates[idx]   = g_cxPosition;
+        g_acCandidateHits[idx] = 0;
+    }
+    
+    if (++g_acCandidateHits[idx] >= TAB_LEARN_HITS)
+    {
+        g_acCandidateHits[idx] = 0;
+        
+        keyboard_send_keystroke(KEY_TSET);
+        terminal_handle_motion(KEY_TSET);
+    }
+}
+
+//
+//  Start a new line; if the carriage is already at the left margin there's
+//  no need for a return, and just feeding the paper is a lot quicker.
+//
+static void terminal_new_line(void)
+{
+    keyid_t nKey = (g_cxPosition == g_cxLeftMargin) ? KEY_LINESPACE : KEY_CRTN;
+    
+    keyboard_send_keystroke(nKey);
+    terminal_handle_motion(nKey);
+}
+
+//
+//  Find the shortest keystroke the typewriter reliably takes.  Each group of
+//  test keystrokes is typed with its press length's digit, so the paper
+//  shows which lengths lose characters; the firmware can only tell for
+//  itself if the typewriter's scan cadence gives away when it's busy, so
+//  without that the press length is left alone.
+//
+static void terminal_calibrate_keystrokes(void)
+{
+    uint8_t cScansFound = 0;
+    
+    g_bMovePending = 0;
+    
+    if (g_cxPosition != g_cxLeftMargin)
+        terminal_new_line();
+    
+    for (uint8_t cScans = 1; cScans <= CALIBRATE_SCANS_MAX; cScans++)
+    {
+        keyid_t nKey  = g_aAsciiKeys['0' + cScans];
+        uint8_t cSeen = 0;
+        
+        for (uint8_t idx = 0; idx < CALIBRATE_KEYS; idx++)
+        {
+            if (keyboard_test_keypress(nKey, cScans))
+                cSeen++;
+            
+            terminal_handle_motion(nKey);
+        }
+        
+        keyboard_send_keystroke(KEY_SPACE);
+        terminal_handle_motion(KEY_SPACE);
+        
+        if (cSeen == CALIBRATE_KEYS)
+        {
+            cScansFound = cScans;
+            break;
+        }
+    }
+    
+    terminal_new_line();
+    
+    if (cScansFound)
+    {
+        for (uint8_t nClass = 0; nClass < KEYCLASS_MAX; nClass++)
+            keyboard_set_press_scans(nClass, cScansFound + CALIBRATE_MARGIN);
+        
+        g_bSaveTimings = 1;
+    }
+}
+
+static enum
+{
+    ESCAPE_NONE = 0,
+    ESCAPE_STARTED,         // had the ESC...
+    ESCAPE_CSI,             // ... and the [, so reading parameters
+} g_nEscapeState = ESCAPE_NONE;
+
+static uint8_t g_anEscapeParams[ESCAPE_PARAMS_MAX];
+static uint8_t g_cEscapeParams = 0;
+
+static void terminal_put_number(uint16_t n)
+{
+    uint16_t nPlace = 10000;
+    
+    while (nPlace > 1 && nPlace > n)
+        nPlace /= 10;
+    
+    do
+    {
+        putchar('0' + (n / nPlace) % 10);
+        nPlace /= 10;
+    } while (nPlace);
+}
+
+static void terminal_key_timing(void)
+{
+    keyclass_t nClass = g_anEscapeParams[0];
+    
+    if (nClass >= KEYCLASS_MAX)
+        return;
+    
+    if (g_cEscapeParams >= 2 && g_anEscapeParams[1])
+    {
+        keyboard_set_press_scans(nClass, g_anEscapeParams[1]);
+        g_bSaveTimings = 1;
+    }
+    
+    if (g_cEscapeParams >= 3)
     {
-        keyid_t nKey = g_aAsciiKeys[ch];
-        
-        if ((nKey & ~KEY_SHIFTED) < KEY_MAX)
-        {
-            if (g_achKeys[nKey] == 0)
-                g_achKeys[nKey] = ch;
-        }
+        keyboard_set_gap_ms(nClass, g_anEscapeParams[2]);
+        g_bSaveTimings = 1;
     }
+    
+    putchar('\033');
+    putchar('[');
+    terminal_put_number(nClass);
+    putchar(';');
+    terminal_put_number(keyboard_get_press_scans(nClass));
+    putchar(';');
+    terminal_put_number(keyboard_get_gap_ms(nClass));
+    putchar('k');
 }
 
-static void terminal_auto_return_toggled(void)
+static char    g_chDirectPrefix = 0;   // waiting for this prefix's byte
+static keyid_t g_nDirectHoldKey = KEY_NONE;
+static uint8_t g_cDirectScans   = 0;
+static uint8_t g_cmsDirectGap   = 0;
+static uint8_t g_cDirectAckKeys = 0;
+static uint8_t g_cDirectUnacked = 0;
+
+static void terminal_start_direct(uint8_t cAckKeys)
 {
-    g_bAutoReturn ^= 1;
+    //
+    //  The host will expect the carriage to be where its motion left it, so
+    //  any motion still pending is finished off before the first direct key.
+    //
+    g_bDirect        = 1;
+    g_chDirectPrefix = 0;
+    g_nDirectHoldKey = KEY_NONE;
+    g_cDirectScans   = 0;
+    g_cmsDirectGap   = 0;
+    g_cDirectAckKeys = cAckKeys;
+    g_cDirectUnacked = 0;
 }
 
-static void terminal_pitch_cycled(void)
+//
+//  Follow what a key the host has typed directly does to Lock, which it
+//  engages and Shift releases, and to the carriage.
+//
+static void terminal_direct_motion(keyid_t nKey)
 {
-    switch (g_cxCharacter)
+    bit bLocked = g_bIsLocked;
+    
+    switch (nKey)
     {
-        case XPI / 10:
-            g_cxCharacter  = XPI / 12;
+        case KEY_LOCK:
+            bLocked = 1;
             break;
             
-        case XPI / 12:
-            g_cxCharacter  = XPI / 15;
+        case KEY_SHIFT:
+            bLocked = 0;
+            break;
+            
+        case KEY_NONE:
+        case KEY_CODE:
+        case KEY_REPEAT:
             break;
             
-        case XPI / 15:
         default:
-            g_cxCharacter  = XPI / 10;
+            terminal_handle_motion(nKey);
             break;
     }
     
-    g_cxBell = g_cxRightMargin - (MARGIN_BELL_CHARS * g_cxCharacter);
+    if (bLocked != g_bIsLocked)
+    {
+        g_bIsLocked = bLocked;
+        g_bLockMoved ^= 1;
+    }
 }
 
-static void terminal_char_printed(uint8_t bCanBreak)
+//
+//  The key a byte from the host stands for, or KEY_NONE if there's no such
+//  key on the keyboard.
+//
+static keyid_t terminal_direct_key(uint8_t nByte)
 {
-    if (g_cxPosition < (11 * XPI))
+    keyid_t nKey = nByte & ~0x80;
+    
+    if (nKey == KEY_UNKNOWN || nKey >= KEY_MAX)
+        return KEY_NONE;
+    
+    return nKey;
+}
+
+//
+//  Act on one byte of direct keystrokes from the host.
+//
+static void terminal_direct(char ch)
+{
+    uint8_t nByte = (uint8_t) ch;
+    char    chPrefix;
+    
+    if (ch == '\033')
     {
-        g_cxPosition += g_cxCharacter;
+        g_bDirect      = 0;
+        g_nEscapeState = ESCAPE_STARTED;
+        return;
     }
-
-    //
-    //  Will the typewriter have inserted an automatic return here?
-    //
-    if (bCanBreak && g_bAutoReturn && g_cxPosition > g_cxBell)
+    
+    if ((chPrefix = g_chDirectPrefix) != 0)
+    {
+        uint8_t nNumber = nByte - DIRECT_NUMBER_BASE;
+        
+        g_chDirectPrefix = 0;
+        
+        //
+        //  An operand that isn't a key byte (for '+') or a number byte (for
+        //  the rest) is a stray, and ignored along with its prefix.
+        //
+        if (chPrefix == '+' ? ! (nByte & 0x80) : nByte < DIRECT_NUMBER_BASE)
+            return;
+        
+        switch (chPrefix)
+        {
+            case '+':
+                g_nDirectHoldKey = terminal_direct_key(nByte);
+                break;
+                
+            case 'P':
+                g_cDirectScans = nNumber;
+                break;
+                
+            case 'G':
+                g_cmsDirectGap = nNumber;
+                break;
+                
+            case 'W':
+                keyboard_send_delay_ms((uint16_t) nNumber * DIRECT_WAIT_MS);
+                break;
+        }
+        
+        return;
+    }
+    
+    if (nByte & 0x80)
+    {
+        keyid_t nKey = terminal_direct_key(nByte);
+        
+        //
+        //  A key that isn't on the keyboard is still counted for the ACKs, so
+        //  the host doesn't lose track of how many have been taken.
+        //
+        if (nKey != KEY_NONE)
+        {
+            keyboard_send_timed_keychord(g_nDirectHoldKey, nKey,
+                                         g_cDirectScans, g_cmsDirectGap);
+            
+            if (g_nDirectHoldKey != KEY_CODE)
+            {
+                terminal_direct_motion(g_nDirectHoldKey);
+                terminal_direct_motion(nKey);
+            }
+        }
+        
+        g_nDirectHoldKey = KEY_NONE;
+        g_cDirectScans   = 0;
+        g_cmsDirectGap   = 0;
+        
+        if (g_cDirectAckKeys && ++g_cDirectUnacked >= g_cDirectAckKeys)
+        {
+            g_cDirectUnacked = 0;
+            putchar(ACK);
+        }
+    }
+    else if (ch == '+' || ch == 'P' || ch == 'G' || ch == 'W')
     {
-        timers_start_holdoff_ms(RETURN_DELAY);        
-        g_cxPosition = g_cxLeftMargin;
+        g_chDirectPrefix = ch;
     }
 }
 
-static void terminal_handle_motion(keyid_t nKey)
+static void terminal_status_report(void)
 {
-    switch (nKey)
+    if (g_anEscapeParams[0] != STATUS_REQUEST)
+        return;
+    
+    putchar('\033');
+    putchar('[');
+    putchar('0');
+    putchar(';');
+    terminal_put_number(uart_get_rx_latency_ms());
+    putchar(';');
+    terminal_put_number(uart_get_tx_dropped());
+    putchar(';');
+    terminal_put_number(keyboard_get_scans_skipped());
+    putchar(';');
+    terminal_put_number(keyboard_get_unverified());
+    putchar(';');
+    terminal_put_number(g_msKeyLatency);
+    putchar('n');
+}
+
+//
+//  Take ch if it's part of an escape sequence, acting on the sequence once
+//  it's complete; returns whether it was.
+//
+static bit terminal_escape(char ch)
+{
+    switch (g_nEscapeState)
     {
-        case KEY_BACKSPC:
-        case KEY_ERASE:
-            if (g_cxPosition > g_cxLeftMargin)
-            {
-                g_cxPosition -= g_cxCharacter;
-            }
+        case ESCAPE_NONE:
+            if (ch != '\033')
+                return 0;
+            
+            g_nEscapeState = ESCAPE_STARTED;
             break;
             
-        case KEY_CRTN:
-        case KEY_MAR_RTN:
-            if (g_cxPosition > g_cxLeftMargin)
+        case ESCAPE_STARTED:
+            if (ch == '[')
             {
-                timers_start_holdoff_ms(RETURN_DELAY);
+                g_anEscapeParams[0] = 0;
+                g_cEscapeParams     = 1;
+                g_nEscapeState      = ESCAPE_CSI;
+            }
+            else if (ch < ' ' || ch > '/')
+            {
+                g_nEscapeState      = ESCAPE_NONE;  // else an intermediate
             }
-            
-            g_cxPosition = g_cxLeftMargin;
-            break;
-            
-        case KEY_MAR_REL:
-            g_cxLeftMargin = 0;
-            break;
-            
-        case KEY_LMAR:
-            g_cxLeftMargin = g_cxPosition;
-            break;
-            
-        case KEY_RMAR:
-            g_cxRightMargin = g_cxPosition;
-            g_cxBell = g_cxRightMargin - (MARGIN_BELL_CHARS * g_cxCharacter);
-            break;
-            
-        case KEY_TSET:
-        case KEY_TCLR:
-        case KEY_PAPER_UP:
-        case KEY_PAPER_DOWN:
-        case KEY_LINESPACE:
-            break;
-            
-        case KEY_SPACE:
-        case KEY_TAB:
-        case KEY_DASH:
-            terminal_char_printed(1);
             break;
             
-        default:
-            terminal_char_printed(0);
+        case ESCAPE_CSI:
+            if (ch >= '0' && ch <= '9')
+            {
+                uint8_t *pnParam = &g_anEscapeParams[g_cEscapeParams - 1];
+                uint16_t nParam  = *pnParam * 10 + (ch - '0');
+                
+                *pnParam = (nParam > 0xff) ? 0xff : (uint8_t) nParam;
+            }
+            else if (ch == ';')
+            {
+                if (g_cEscapeParams < ESCAPE_PARAMS_MAX)
+                    g_anEscapeParams[g_cEscapeParams++] = 0;
+            }
+            else if (ch >= '@' && ch <= '~')
+            {
+                g_nEscapeState = ESCAPE_NONE;
+                
+                if (ch == 'k')
+                    terminal_key_timing();
+                else if (ch == 'z')
+                    terminal_start_direct(g_anEscapeParams[0]);
+                else if (ch == 'n')
+                    terminal_status_report();
+            }
             break;
     }
+    
+    return 1;
 }
 
-static void terminal_inject_ascii(char ch)
+//
+//  Feed the paper through to the top of the next page; the feeds themselves
+//  are sent from terminal_process(), a few at a time.
+//
+static void terminal_form_feed(void)
 {
-    keyid_t nKey = (ch < 128) ? g_aAsciiKeys[ch] : KEY_NONE;
+    if (g_cxPosition != g_cxLeftMargin)
+        terminal_new_line();
     
-    if (nKey == KEY_NONE)
-        return;
+    if (g_nPageLine != 0)
+        g_cFeedsPending = PAGE_LINES - g_nPageLine;
+}
+
+//
+//  There's a character to print after some motion from the host, so the
+//  carriage has to go where the motion left it after all; returns whether
+//  it's there yet.  Whether to learn a stop there is decided on the first
+//  go, before the carriage has moved.
+//
+static bit terminal_commit_motion(char chNext)
+{
+    static bit s_bLearn = 0;
+    
+    if (! g_bMovePending || chNext >= 128 || g_aAsciiKeys[chNext] == KEY_NONE)
+        return 1;
     
-    if (nKey & KEY_SHIFTED)
+    if (! g_chMoveNext)
     {
-        if (g_bIsShifted || g_bIsLocked)
-        {
-            keyboard_send_keystroke(nKey & ~KEY_SHIFTED);
-        }
-        else
-        {
-            keyboard_send_keychord(KEY_SHIFT, nKey & ~KEY_SHIFTED);
-        }
+        s_bLearn = g_bLearnTabs && chNext != ' ' &&
+                   g_cxTarget >= g_cxPosition + TAB_LEARN_GAP * g_cxCharacter &&
+                   g_cxTarget > g_cxLeftMargin;
     }
-    else
+    
+    if (! terminal_move_to(g_cxTarget))
+        return 0;
+    
+    if (s_bLearn)
     {
-        if (g_bIsLocked)
-        {
-            keyboard_send_keystroke(KEY_SHIFT);
-            keyboard_send_keystroke(nKey);
-            keyboard_send_keystroke(KEY_LOCK);
-        }
-        else if (g_bIsShifted)
-        {
-            //
-            //  Wait for the user to release the Shift key before continuing.
-            //
-            g_chPending = ch;
-            return;
-        }
-        else
-        {
-            keyboard_send_keystroke(nKey);
-        }
+        if (keyboard_get_queue_space() == 0)
+            return 0;
+        
+        s_bLearn = 0;
+        terminal_learn_tab_stop();
     }
     
-    terminal_handle_motion(nKey & ~KEY_SHIFTED);
+    g_bMovePending = 0;
+    return 1;
+}
+
+//
+//  Print ch, once the carriage has got to where the host's motion left it
+//  and there's room to type it; until then it's kept in g_chMoveNext, and
+//  this is called again for it from terminal_process().
+//
+static void terminal_print(char ch)
+{
+    if (! terminal_commit_motion(ch) ||
+        keyboard_get_queue_space() < KEYSTROKES_PER_CHAR)
+    {
+        g_chMoveNext = ch;
+        return;
+    }
+    
+    g_chMoveNext = 0;
+    terminal_inject_ascii(ch);
+    terminal_inject_repeats(ch);
 }
 
 static void terminal_keyevent(keyevent_t nEvent)
@@ -250,6 +1230,7 @@ static void terminal_keyevent(keyevent_t nEvent)
     {
         g_bIsShifted = keyboard_is_down_event(nEvent);
         g_bIsLocked  = g_bIsShifted ? 0 : g_bIsLockDown;        
+        g_bLockMoved = 0;
         return;
     }
     
@@ -260,6 +1241,7 @@ static void terminal_keyevent(keyevent_t nEvent)
     {
         g_bIsLocked   = g_bIsShifted ? 0 : 1;
         g_bIsLockDown = keyboard_is_down_event(nEvent);
+        g_bLockMoved  = 0;
         return;
     }
 
@@ -327,7 +1309,7 @@ static void terminal_keyevent(keyevent_t nEvent)
             timers_start_typematic_ms(TYPEMATIC_INTERVAL);
             
             if (g_chRepeat)
-                putchar(g_chRepeat);    // TODO: handle motion!
+                uart_try_putch(g_chRepeat);     // TODO: handle motion!
         }
     }
     
@@ -357,6 +1339,30 @@ static void terminal_keyevent(keyevent_t nEvent)
                 terminal_auto_return_toggled();
                 return;
                 
+            case KEY_L:
+                terminal_learn_tabs_toggled();
+                return;
+                
+            case KEY_X:
+                uart_toggle_xonxoff();
+                return;
+                
+            case KEY_D:
+                uart_toggle_dsr_flow();
+                return;
+                
+            case KEY_B:
+                uart_cycle_baud();
+                return;
+                
+            case KEY_A:
+                uart_start_autobaud();
+                return;
+                
+            case KEY_K:
+                g_bCalibrate = 1;   // once Code's been let go
+                return;
+                
             case KEY_Q:
             case KEY_T:
             case KEY_U:
@@ -430,12 +1436,14 @@ static void terminal_keyevent(keyevent_t nEvent)
     {
         putchar(ch);
         g_chRepeat = ch;
+#if KEYBOARD_EVENT_TIMES
+        g_msKeyLatency = (uint16_t) timers_get_ms() - keyboard_get_event_ms();
+#endif
     }
 }
 
 void terminal_init(void)
 {
-    terminal_init_ascii_table();
 }
 
 void terminal_process(void)
@@ -453,19 +1461,39 @@ void terminal_process(void)
         timers_start_typematic_ms(TYPEMATIC_INTERVAL);
         
         if (g_chRepeat)
-            putchar(g_chRepeat);        // TODO: handle motion
+            uart_try_putch(g_chRepeat);         // TODO: handle motion
     }
     
-    if (g_bSendCtrl || g_bIsCode || timers_is_holdoff_running())
+    if (g_bSendCtrl || g_bIsCode ||
+        keyboard_get_queue_space() < KEYSTROKES_PER_CHAR)
     {
         //
         //  Don't attempt to process any input if we're Code-shifted, waiting
-        //  for the second key of a Code, <key> combination, or in the waiting
-        //  period between injected keystrokes watching for user interaction.
+        //  for the second key of a Code, <key> combination, or if the keyboard
+        //  driver couldn't take every keystroke for another character yet.
         //
         return;
     }
     
+    if (g_bCalibrate)
+    {
+        g_bCalibrate = 0;
+        terminal_calibrate_keystrokes();
+        return;
+    }
+    
+    if (g_cFeedsPending)
+    {
+        while (g_cFeedsPending && keyboard_get_queue_space() != 0)
+        {
+            keyboard_send_keystroke(KEY_LINESPACE);
+            terminal_handle_motion(KEY_LINESPACE);
+            g_cFeedsPending--;
+        }
+        
+        return;
+    }
+    
     if (g_chPending)
     {
         //
@@ -499,15 +1527,94 @@ void terminal_process(void)
         return;
     }
     
+    if (g_chMoveNext)
+    {
+        terminal_print(g_chMoveNext);
+        return;
+    }
+    
+    if (g_bDirect && g_bMovePending)
+    {
+        if (terminal_move_to(g_cxTarget))
+            g_bMovePending = 0;
+        
+        return;
+    }
+    
     if ((ch = uart_get_rx_byte()) != 0)
     {
         static bit s_bSwallowLf = 0;
         
-        if (! (ch == '\n' && s_bSwallowLf))
+        if (g_bDirect)
         {
-            terminal_inject_ascii(ch);
+            terminal_direct(ch);
+            return;
+        }
+        
+        if (terminal_escape(ch))
+            return;
+        
+        if (! g_bMovePending)
+        {
+            g_cxTarget = g_cxPosition;
+        }
+        
+        if (terminal_apply_motion(ch, uart_peek_rx_byte(0), &g_cxTarget))
+        {
+            //
+            //  Take all of the motion that follows as well; the carriage is
+            //  only moved once there's something to print at the end of it.
+            //
+            while (terminal_apply_motion(uart_peek_rx_byte(0),
+                                         uart_peek_rx_byte(1), &g_cxTarget))
+            {
+                uart_get_rx_byte();
+            }
+            
+            g_bMovePending = 1;
+        }
+        else if (ch == '\n' && s_bSwallowLf)
+        {
+            //
+            //  Already started a new line for the CR before it.
+            //
+        }
+        else if (ch == '\r' || ch == '\n')
+        {
+            g_bMovePending = 0;   // no point spacing out to the line's end
+            terminal_new_line();
+        }
+        else if (ch == '\f')
+        {
+            g_bMovePending = 0;
+            terminal_form_feed();
+        }
+        else
+        {
+            terminal_print(ch);
         }
         
         s_bSwallowLf = (ch == '\r');
     }
+    else if (g_bLockMoved && ! g_bDirect && ! keyboard_is_sending())
+    {
+        //
+        //  Nothing more to type for now, so put Lock back how the user had it.
+        //
+        terminal_toggle_lock();
+    }
+    else if (g_bSaveTimings && ! keyboard_is_sending())
+    {
+        //
+        //  If the host won't stop sending, writing to flash would lose what
+        //  it sends; leave the save for the next time there's a lull.
+        //
+        if (uart_hold_sender())
+        {
+            g_bSaveTimings = 0;
+            keyboard_save_timings();
+        }
+        
+        uart_release_sender();
+    }
 }
\ No newline at end of file
@@ -9,9 +9,38 @@
 # error Crystal frequency does not allow 1ms with selected TMR0 prescaler value.
 #endif
 
-static volatile uint16_t g_cmsHoldoff   = 0;
-static volatile uint16_t g_cmsBlink     = 0;
-static volatile uint16_t g_cmsTypematic = 0;
+//
+//  Timer1 overflows every 65536 ticks, which is a whole number of ms plus a
+//  remainder; the ISR keeps the millisecond clock as of the last overflow,
+//  with the remainder kept in units of 256 ticks (one count of TMR1H).
+//
+#define TMR1_MS_PER_OVERFLOW    (65536UL / TIMERS_TICKS_PER_MS)
+#define TMR1_HIGH_PER_MS        (TIMERS_TICKS_PER_MS / 256)
+#define TMR1_HIGH_REMAINDER     (256 - TMR1_MS_PER_OVERFLOW * TMR1_HIGH_PER_MS)
+
+#if TIMERS_TICKS_PER_MS % 256 != 0
+# error Crystal frequency does not give a whole number of TMR1H counts per ms.
+#endif
+
+static volatile uint16_t g_cOverflows   = 0;
+static volatile uint32_t g_msOverflow   = 0;
+static volatile uint8_t  g_nHighCarry   = 0;
+
+//
+//  Each timer has an absolute deadline on a millisecond clock that only runs
+//  while some timer is running.  The tick ISR just advances the clock and
+//  compares it with the earliest deadline, so its cost doesn't depend on the
+//  number of timers; they're only looked through when one expires, or when
+//  one is started or stopped.
+//
+static volatile uint16_t g_msNow     = 0;
+static volatile uint16_t g_msNext    = 0;   // earliest running deadline
+static volatile uint16_t g_amsDeadline[TIMER_MAX];
+static volatile uint8_t  g_fRunning  = 0;   // bit per timer, so up to eight
+
+#if TIMER_MAX > 8
+# error Too many timers for the g_fRunning bitmask!
+#endif
 
 void timers_init(void)
 {
@@ -55,11 +84,76 @@ void timers_init(void)
     TMR0CS = 0;
     TMR0   = TMR0_RELOAD_VALUE;
     TMR0IE = 0;
+    
+    //
+    //  Start Timer1 free-running from the instruction clock, as the clock for
+    //  timestamps (the keyboard driver times the scan trains with it, too).
+    //
+    TMR1CS1 = 0;
+    TMR1CS0 = 0;
+#if   TMR1_PRESCALER == 1
+    T1CKPS1 = 0;    T1CKPS0 = 0;
+#elif TMR1_PRESCALER == 2
+    T1CKPS1 = 0;    T1CKPS0 = 1;
+#elif TMR1_PRESCALER == 4
+    T1CKPS1 = 1;    T1CKPS0 = 0;
+#elif TMR1_PRESCALER == 8
+    T1CKPS1 = 1;    T1CKPS0 = 1;
+#else
+# error Unsupported TMR1 prescaler value - must be 1, 2, 4 or 8
+#endif
+    TMR1IF  = 0;
+    TMR1IE  = 1;
+    PEIE    = 1;
+    TMR1ON  = 1;
+}
+
+//
+//  Work out which deadline is next, once something's changed; stops the
+//  tick altogether if there's nothing left running.  Called with interrupts
+//  off (or from the ISR).
+//
+static void timers_find_next(void)
+{
+    uint16_t cmsNext = 0xffff;
+    uint8_t  fTimer  = 1;
+    
+    for (uint8_t nTimer = 0; nTimer < TIMER_MAX; nTimer++, fTimer <<= 1)
+    {
+        if (g_fRunning & fTimer)
+        {
+            uint16_t cmsLeft = g_amsDeadline[nTimer] - g_msNow;
+            
+            if (cmsLeft < cmsNext)
+                cmsNext = cmsLeft;
+        }
+    }
+    
+    g_msNext = g_msNow + cmsNext;
 }
 
 void timers_isr(void)
 {
-    if (TMR0IF)
+    //
+    //  We're also entered for the tick, so check TMR1IE too; it's turned off
+    //  while the overflow count's being read.
+    //
+    if (TMR1IF && TMR1IE)
+    {
+        TMR1IF = 0;
+        
+        g_cOverflows++;
+        g_msOverflow += TMR1_MS_PER_OVERFLOW;
+        g_nHighCarry += TMR1_HIGH_REMAINDER;
+        
+        if (g_nHighCarry >= TMR1_HIGH_PER_MS)
+        {
+            g_nHighCarry -= TMR1_HIGH_PER_MS;
+            g_msOverflow++;
+        }
+    }
+    
+    if (TMR0IF && TMR0IE)
     {
         //
         //  Reload counter for 1ms tick...
@@ -67,99 +161,182 @@ void timers_isr(void)
         TMR0  += TMR0_RELOAD_VALUE;
         TMR0IF = 0;
         
+        if ((int16_t) (g_msNext - ++g_msNow) > 0)
+            return;
+        
         //
-        //  ... and handle any running timers
+        //  ... and expire whichever timers are due (or overdue, so a deadline
+        //  can't be missed and left running until the clock comes round).
         //
-        TMR0IE = 0;
-
-        if (g_cmsHoldoff)
-        {
-            if (--g_cmsHoldoff > 0)
-            {
-                TMR0IE = 1;
-            }
-        }
+        uint8_t fTimer = 1;
         
-        if (g_cmsBlink)
+        for (uint8_t nTimer = 0; nTimer < TIMER_MAX; nTimer++, fTimer <<= 1)
         {
-            if (--g_cmsBlink > 0)
-            {
-                TMR0IE = 1;
-            }
+            if ((g_fRunning & fTimer) &&
+                (int16_t) (g_amsDeadline[nTimer] - g_msNow) <= 0)
+                g_fRunning &= ~fTimer;
         }
         
-        if (g_cmsTypematic)
-        {
-            if (--g_cmsTypematic > 0)
-            {
-                TMR0IE = 1;
-            }
-        }
+        if (g_fRunning)
+            timers_find_next();
+        else
+            TMR0IE = 0;
     }
 }
 
-static void timers_start(void)
+//
+//  Start a timer, or if it's already running add to the time it has left.
+//  These run with interrupts off altogether, not just the tick, so an ISR
+//  can use them too.
+//
+void timers_start_ms(timer_id_t nTimer, uint16_t cmsDelay)
 {
-    if (!TMR0IE)
+    uint8_t fTimer  = 1 << nTimer;
+    uint8_t bOldGIE = GIE;
+    uint8_t bOldIE;
+
+    GIE    = 0;
+    bOldIE = TMR0IE;
+    
+    if (g_fRunning & fTimer)
     {
-        TMR0   = TMR0_RELOAD_VALUE;
-        TMR0IE = 1;
+        g_amsDeadline[nTimer] += cmsDelay;
     }
+    else if (cmsDelay)
+    {
+        g_amsDeadline[nTimer] = g_msNow + cmsDelay;
+        g_fRunning |= fTimer;
+    }
+    
+    if (g_fRunning)
+        timers_find_next();
+    
+    if (! bOldIE && g_fRunning)
+        TMR0 = TMR0_RELOAD_VALUE;
+    
+    TMR0IE = (g_fRunning != 0);
+    GIE    = bOldGIE;
 }
 
-void timers_start_holdoff_ms(uint16_t cmsDelay)
+void timers_stop(timer_id_t nTimer)
 {
-    uint8_t bOldIE  = TMR0IE;
+    uint8_t bOldGIE = GIE;
 
-    TMR0IE = 0;
-    g_cmsHoldoff += cmsDelay;
-    TMR0IE = bOldIE;
+    GIE = 0;
+    
+    g_fRunning &= ~(1 << nTimer);
     
-    timers_start();
+    if (g_fRunning)
+        timers_find_next();
+    else
+        TMR0IE = 0;
+    
+    GIE = bOldGIE;
 }
 
-bit timers_is_holdoff_running(void)
+bit timers_is_running(timer_id_t nTimer)
 {
-    return (g_cmsHoldoff > 0);
+    return (g_fRunning & (1 << nTimer)) != 0;
 }
 
-void timers_start_blink_ms(uint16_t cmsDelay)
+uint16_t timers_get_remaining_ms(timer_id_t nTimer)
 {
-    uint8_t bOldIE  = TMR0IE;
+    uint8_t  bOldGIE = GIE;
+    uint16_t cmsLeft = 0;
 
-    TMR0IE = 0;
-    g_cmsBlink += cmsDelay;
-    TMR0IE = bOldIE;
+    GIE = 0;
+    
+    if (g_fRunning & (1 << nTimer))
+        cmsLeft = g_amsDeadline[nTimer] - g_msNow;
+    
+    GIE = bOldGIE;
     
-    timers_start();
+    return cmsLeft;
 }
 
-bit timers_is_blink_running(void)
+//
+//  Read Timer1 along with the overflow count and millisecond clock as of its
+//  last overflow, allowing for an overflow the ISR hasn't got to yet.
+//
+static uint16_t timers_read_timer1(uint16_t *pcOverflows, uint32_t *pms,
+                                   uint8_t *pnCarry)
 {
-    return (g_cmsBlink > 0);
+    uint8_t nHigh, nLow;
+    uint8_t bOldIE = TMR1IE;
+    
+    TMR1IE = 0;
+    
+    nHigh = TMR1H;
+    nLow  = TMR1L;
+    
+    if (nHigh != TMR1H)
+    {
+        nHigh = TMR1H;      // the low byte wrapped between the reads
+        nLow  = TMR1L;
+    }
+    
+    *pcOverflows = g_cOverflows;
+    *pms         = g_msOverflow;
+    *pnCarry     = g_nHighCarry;
+    
+    if (TMR1IF && nHigh < 0x80)
+    {
+        (*pcOverflows)++;
+        *pms     += TMR1_MS_PER_OVERFLOW;
+        *pnCarry += TMR1_HIGH_REMAINDER;
+    }
+    
+    TMR1IE = bOldIE;
+    
+    return ((uint16_t) nHigh << 8) | nLow;
 }
 
-void timers_start_typematic_ms(uint16_t cmsDelay)
+//
+//  Timer1 ticks (TIMERS_TICKS_PER_MS of them per ms) since power-up; wraps
+//  after half an hour, so it's for timing intervals rather than telling the
+//  time.
+//
+uint32_t timers_get_ticks(void)
 {
-    uint8_t bOldIE  = TMR0IE;
-
-    TMR0IE = 0;
-    g_cmsTypematic += cmsDelay;
-    TMR0IE = bOldIE;
+    uint16_t cOverflows;
+    uint32_t ms;
+    uint8_t  nCarry;
+    uint16_t nTimer = timers_read_timer1(&cOverflows, &ms, &nCarry);
     
-    timers_start();
+    return ((uint32_t) cOverflows << 16) | nTimer;
 }
 
-void timers_stop_typematic(void)
+//
+//  Timer1 ticks / 256 (i.e. TMR1H, extended by the overflow count) since
+//  power-up; wraps every couple of minutes.  This is cheap enough for the
+//  keyboard ISR to timestamp scan trains with.
+//
+uint16_t timers_get_high_ticks(void)
 {
-    uint8_t bOldIE  = TMR0IE;
-
-    TMR0IE = 0;
-    g_cmsTypematic = 0;
-    TMR0IE = bOldIE;
+    uint8_t bOldIE = TMR1IE;
+    
+    TMR1IE = 0;
+    
+    uint8_t nHigh      = TMR1H;
+    uint8_t cOverflows = (uint8_t) g_cOverflows;
+    
+    if (TMR1IF && nHigh < 0x80)
+        cOverflows++;   // the overflow interrupt hasn't been serviced yet
+    
+    TMR1IE = bOldIE;
+    
+    return ((uint16_t) cOverflows << 8) | nHigh;
 }
 
-bit timers_is_typematic_running(void)
+//
+//  Milliseconds since power-up; wraps after 49 days.
+//
+uint32_t timers_get_ms(void)
 {
-    return (g_cmsTypematic > 0);
-}
\ No newline at end of file
+    uint16_t cOverflows;
+    uint32_t ms;
+    uint8_t  nCarry;
+    uint16_t nTimer = timers_read_timer1(&cOverflows, &ms, &nCarry);
+    
+    return ms + (uint16_t) (nCarry + (nTimer >> 8)) / TMR1_HIGH_PER_MS;
+}
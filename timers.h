@@ -14,6 +14,22 @@
 
 #define timers_block_ms(N) __delay_ms(N)
 
+//
+//  Timer1 free-runs at Fcy / TMR1_PRESCALER as the system clock.
+//
+#define TMR1_PRESCALER      2
+#define TIMERS_TICKS_PER_MS (_XTAL_FREQ / (4UL * TMR1_PRESCALER * 1000))
+
+//
+//  Called from every busy-wait loop; there's nothing to do on the PIC, but the
+//  host build uses it to let the emulated peripherals move on while we spin.
+//
+#ifdef HOST_BUILD
+# define timers_idle() host_idle()
+#else
+# define timers_idle()
+#endif
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -21,15 +37,29 @@ extern "C" {
     extern void timers_init(void);
     extern void timers_isr(void);
     
-    extern void timers_start_holdoff_ms(uint16_t cmsDelay);
-    extern bit  timers_is_holdoff_running(void);
+    extern uint32_t timers_get_ms(void);
+    extern uint32_t timers_get_ticks(void);
+    extern uint16_t timers_get_high_ticks(void);
     
-    extern void timers_start_blink_ms(uint16_t cmsDelay);
-    extern bit  timers_is_blink_running(void);
+    typedef enum
+    {
+        TIMER_BLINK = 0,        // alert LED flashing
+        TIMER_TYPEMATIC,        // local Space/Repeat autorepeat
+
+        TIMER_MAX
+    } timer_id_t;
     
-    extern void timers_start_typematic_ms(uint16_t cmsDelay);
-    extern void timers_stop_typematic(void);
-    extern bit  timers_is_typematic_running(void);
+    extern void timers_start_ms(timer_id_t nTimer, uint16_t cmsDelay);
+    extern void timers_stop(timer_id_t nTimer);
+    extern bit  timers_is_running(timer_id_t nTimer);
+    extern uint16_t timers_get_remaining_ms(timer_id_t nTimer);
+
+#define timers_start_blink_ms(cms)      timers_start_ms(TIMER_BLINK, cms)
+#define timers_is_blink_running()       timers_is_running(TIMER_BLINK)
+
+#define timers_start_typematic_ms(cms)  timers_start_ms(TIMER_TYPEMATIC, cms)
+#define timers_stop_typematic()         timers_stop(TIMER_TYPEMATIC)
+#define timers_is_typematic_running()   timers_is_running(TIMER_TYPEMATIC)
 
 #ifdef	__cplusplus
 }
@@ -1,39 +1,217 @@
 #include <xc.h>
 #include "uart.h"
+#include "timers.h"
+#include "keyboard.h"
 
-#define TX_BUFFER_SIZE 8
-#define RX_BUFFER_SIZE 64
-#define RX_BUFFER_HIGHWATER 32
-#define RX_BUFFER_LOWWATER  8
+#define TX_BUFFER_SIZE 64       // power of two, at most 128
+#define TX_BUFFER_MASK (TX_BUFFER_SIZE - 1)
+#define RX_BUFFER_SIZE 256      // power of two, at most 256
+#define RX_BUFFER_MASK (RX_BUFFER_SIZE - 1)
 
+//
+//  Flow control thresholds.  The sender can take a while to notice DTR (a
+//  USB adapter may have a FIFO's worth already on its way), so stop it while
+//  there's still RX_BUFFER_SKID bytes free; the typewriter only drains the
+//  buffer at a dozen or so characters a second, so there's no hurry to start
+//  it again, and keeping half the buffer full gives the lookahead in the
+//  terminal a line or two to work with.
+//
+#define RX_BUFFER_SKID      32
+#define RX_BUFFER_HIGHWATER (RX_BUFFER_SIZE - 1 - RX_BUFFER_SKID)
+#define RX_BUFFER_LOWWATER  (RX_BUFFER_SIZE / 2)
+
+//
+//  With XON/XOFF flow control the sender only stops once it's seen the XOFF,
+//  which may have to wait behind whatever we're already transmitting and then
+//  get through the host's own buffering, so allow twice as much headroom; if
+//  bytes keep coming anyway, send XOFF again every RX_BUFFER_XOFF_REPEAT.
+//
+#define RX_BUFFER_XOFF_SKID     (2 * RX_BUFFER_SKID)
+#define RX_BUFFER_XOFF_HIGHWATER (RX_BUFFER_SIZE - 1 - RX_BUFFER_XOFF_SKID)
+#define RX_BUFFER_XOFF_REPEAT   16
+
+//
+//  How long the line has to have been idle before we can be sure the sender
+//  has stopped: a couple of bytes' time at the slowest baud rate.
+//
+#define RX_QUIET_MS         20
+#define RX_HOLD_MS          300     // ... and how long to give it to stop
+
+#define XON                 0x11    // DC1
+#define XOFF                0x13    // DC3
+#define POWERUP_XONXOFF     0       // start up using DTR/DSR
+
+//
+//  Not every host or cable drives DSR, and RA2 has no pull-down, so with DTR
+//  flow control we only stop sending when DSR's dropped if that's been turned
+//  on with Code-D; otherwise the host could hold us up for good.
+//
+#define POWERUP_DSR_FLOW    0
+
+//
+//  Baud rates to cycle through with Code-B.  The crystal divides exactly into
+//  all of them using the 16-bit baud rate generator in high-speed mode, where
+//  each bit is (n + 1) * 4 oscillator cycles.
+//
+#define BAUD_DIVISOR(baud)  ((unsigned int) (_XTAL_FREQ / (4UL * (baud)) - 1))
+
+static const unsigned int anBaudDivisors[] = {
+    BAUD_DIVISOR(1200),  BAUD_DIVISOR(2400),  BAUD_DIVISOR(4800),
+    BAUD_DIVISOR(9600),  BAUD_DIVISOR(19200), BAUD_DIVISOR(38400),
+    BAUD_DIVISOR(57600), BAUD_DIVISOR(115200),
+};
+
+#define BAUD_RATES          (sizeof(anBaudDivisors) / sizeof(anBaudDivisors[0]))
+#define POWERUP_BAUD_INDEX  3       // 9600
+
+//
+//  The transmit indices run freely too, but the buffer's small enough that
+//  write - read can count all the way up to a full one.
+//
 #if TX_BUFFER_SIZE > 0
 static volatile char achTxBuffer[TX_BUFFER_SIZE];
 static volatile unsigned char idxTxRead = 0, idxTxWrite = 0;
+static unsigned int cTxDropped = 0;
 #endif
 
+//
+//  The receive indices run freely and are masked on each access, so that
+//  write - read is always the number of bytes in the buffer; one slot is
+//  kept empty so a full buffer can't look like an empty one.  The buffer's
+//  too big for a bank, so it lives in linear memory after the keyboard's
+//  injection table.
+//
 #if RX_BUFFER_SIZE > 0
+#ifndef HOST_BUILD
+static volatile char achRxBuffer[RX_BUFFER_SIZE] @ 0x2100;
+#else
 static volatile char achRxBuffer[RX_BUFFER_SIZE];
+#endif
 static volatile unsigned char idxRxRead = 0, idxRxWrite = 0;
+
+//
+//  Latency through the buffer is sampled a byte at a time: if no byte's being
+//  timed, the arrival time of the next one is noted, and the latency worked
+//  out when it's taken from the buffer to be typed.
+//
+static volatile bit bRxTiming = 0;
+static volatile unsigned char idxRxTimed;
+static volatile uint16_t msRxTimed;
+static uint16_t cmsRxLatency = 0;
 #endif
 
 #define nDTR LATA3
 #define nDSR PORTA2
 
+static bit bXonXoff = POWERUP_XONXOFF;
+static bit bDsrFlow = POWERUP_DSR_FLOW;
+static bit bSenderBlocked = 0;
+static volatile bit bTxHeld = 0;            // host sent us XOFF
+static volatile char chTxFlow = 0;          // XON/XOFF to send before anything else
+static unsigned char idxBaud = POWERUP_BAUD_INDEX;
+static volatile bit bAutoBaud = 0;          // waiting for a 'U' to time
+
+//
+//  Has the host asked us to stop sending, by XOFF or by dropping DSR
+//  (depending on which sort of flow control we're using)?
+//
+static bit uart_is_tx_held(void)
+{
+    return bXonXoff ? bTxHeld : (bDsrFlow && nDSR);
+}
+
+static void uart_send_flow_control(char ch)
+{
+    chTxFlow = ch;
+    TXIE = 1;
+}
+
 void uart_block_sender(void)
 {
-    nDTR = 1;
+    bSenderBlocked = 1;
+    
+    if (bXonXoff)
+        uart_send_flow_control(XOFF);
+    else
+        nDTR = 1;
 }
 
 void uart_unblock_sender(void)
 {
-    nDTR = 0;
+    bSenderBlocked = 0;
+    
+    if (bXonXoff)
+        uart_send_flow_control(XON);
+    else
+        nDTR = 0;
+}
+
+void uart_toggle_xonxoff(void)
+{
+    bit bBlocked;
+    
+    RCIE = 0;
+    
+    bBlocked = bSenderBlocked;
+    
+    if (bBlocked)
+        uart_unblock_sender();
+    
+    bXonXoff ^= 1;
+    bTxHeld   = 0;
+    nDTR      = 0;
+    
+    if (bBlocked)
+        uart_block_sender();
+    
+    RCIE = 1;
+}
+
+void uart_toggle_dsr_flow(void)
+{
+    bDsrFlow ^= 1;      // uart_update() restarts sending if it's let go
+}
+
+static void uart_set_divisor(unsigned int nDivisor)
+{
+    while (! TRMT)
+        timers_idle();  // let the byte going out finish at the old rate
+    
+    SPBRGH = nDivisor >> 8;
+    SPBRGL = nDivisor & 0xff;
+}
+
+void uart_cycle_baud(void)
+{
+    if (++idxBaud >= BAUD_RATES)
+        idxBaud = 0;
+    
+    bAutoBaud = 0;
+    ABDEN     = 0;
+    
+    uart_set_divisor(anBaudDivisors[idxBaud]);
+}
+
+//
+//  Have the EUSART time the next byte received, which must be a 'U', and set
+//  the baud rate to match; the byte itself is thrown away by the RX ISR.
+//
+void uart_start_autobaud(void)
+{
+    RCIE = 0;
+    
+    ABDOVF    = 0;
+    bAutoBaud = 1;
+    ABDEN     = 1;
+    
+    RCIE = 1;
 }
 
 void uart_init(void)
 {
-    BRGH  = 0;
-    BRG16 = 0;
-    SPBRG = 29;
+    BRGH  = 1;
+    BRG16 = 1;
+    uart_set_divisor(anBaudDivisors[POWERUP_BAUD_INDEX]);
 
     TRISC6 = 1;
     TRISC7 = 1;
@@ -59,60 +237,248 @@ void uart_init(void)
 
 void uart_tx_isr(void)
 {
+    if (chTxFlow)
+    {
+        TXREG    = chTxFlow;
+        chTxFlow = 0;
+    }
 #if TX_BUFFER_SIZE > 0
-    TXREG = achTxBuffer[idxTxRead++];
-    if (idxTxRead == TX_BUFFER_SIZE)
-        idxTxRead = 0;
+    else if (idxTxRead != idxTxWrite && ! uart_is_tx_held())
+    {
+        TXREG = achTxBuffer[idxTxRead & TX_BUFFER_MASK];
+        idxTxRead++;
+    }
     
-    if (idxTxRead == idxTxWrite)
+    if (idxTxRead == idxTxWrite || uart_is_tx_held())
         TXIE = 0;
+#else
+    TXIE = 0;
+#endif
+}
+
+//
+//  Restart transmission if the host's let go of DSR since the TX ISR found
+//  it held; XON restarts it from the receive ISR.
+//
+void uart_update(void)
+{
+#if TX_BUFFER_SIZE > 0
+    if (idxTxRead != idxTxWrite && ! TXIE && ! uart_is_tx_held())
+        TXIE = 1;
 #endif
 }
 
 #if RX_BUFFER_SIZE > 0
-static unsigned char uart_rx_buffer_remaining(void)
+static unsigned char uart_rx_buffer_used(void)
 {
-    return (idxRxWrite > idxRxRead) ?
-           (idxRxWrite - idxRxRead) :
-           (RX_BUFFER_SIZE - idxRxRead + idxRxWrite);
+    return (unsigned char) (idxRxWrite - idxRxRead) & RX_BUFFER_MASK;
+}
+#endif
+
+//
+//  Stop the host sending and wait for it to actually stop, before something
+//  that'll keep interrupts off for longer than the receiver can buffer (like
+//  writing to flash); uart_release_sender() lets it carry on afterwards,
+//  whether or not it did.  Returns 0 if it's still sending after RX_HOLD_MS,
+//  e.g. because it ignores flow control.
+//
+bit uart_hold_sender(void)
+{
+    uint16_t msStart;
+    uint16_t msIdle;
+    
+    uart_block_sender();
+    msStart = (uint16_t) timers_get_ms();
+    msIdle  = msStart;
+    
+    while ((uint16_t) timers_get_ms() - msIdle < RX_QUIET_MS)
+    {
+        if (! RCIDL)
+            msIdle = (uint16_t) timers_get_ms();
+        
+        if ((uint16_t) timers_get_ms() - msStart >= RX_HOLD_MS)
+            return 0;
+        
+        keyboard_update();
+        timers_idle();
+    }
+    
+    return 1;
 }
+
+void uart_release_sender(void)
+{
+#if RX_BUFFER_SIZE > 0
+    if (uart_rx_buffer_used() > RX_BUFFER_LOWWATER)
+        return;     // uart_get_rx_byte() will, once there's room
 #endif
+    
+    uart_unblock_sender();
+}
 
 void uart_rx_isr(void)
 {
 #if RX_BUFFER_SIZE > 0
-    achRxBuffer[idxRxWrite++] = RCREG;
-    if (idxRxWrite == RX_BUFFER_SIZE)
+    char          ch   = RCREG;
+    unsigned char used = uart_rx_buffer_used();
+    
+    if (bAutoBaud)
+    {
+        //
+        //  That was the 'U' we timed; if the count overflowed, it was too slow
+        //  for any rate we support, so go back to the one we had.
+        //
+        bAutoBaud = 0;
+        ABDEN     = 0;
+        
+        if (ABDOVF)
+        {
+            ABDOVF = 0;
+            SPBRGH = anBaudDivisors[idxBaud] >> 8;
+            SPBRGL = anBaudDivisors[idxBaud] & 0xff;
+        }
+        
+        return;
+    }
+    
+    if (bXonXoff && (ch == XON || ch == XOFF))
     {
-        idxRxWrite = 0;
+        bTxHeld = (ch == XOFF);
+        
+        if (! bTxHeld)
+            TXIE = 1;
+        
+        return;
     }
     
-    if (uart_rx_buffer_remaining() < RX_BUFFER_HIGHWATER)
+    if (used >= RX_BUFFER_SIZE - 1)
+    {
+        return;     // sender ignored DTR; nowhere to put it
+    }
+    
+    achRxBuffer[idxRxWrite & RX_BUFFER_MASK] = ch;
+    
+    if (! bRxTiming)
+    {
+        idxRxTimed = idxRxWrite;
+        msRxTimed  = (uint16_t) timers_get_ms();
+        bRxTiming  = 1;
+    }
+    
+    idxRxWrite++;
+    
+    used++;
+    
+    if (bXonXoff)
+    {
+        if (used >= RX_BUFFER_XOFF_HIGHWATER &&
+            (! bSenderBlocked ||
+             (used - RX_BUFFER_XOFF_HIGHWATER) % RX_BUFFER_XOFF_REPEAT == 0))
+        {
+            uart_block_sender();
+        }
+    }
+    else if (used >= RX_BUFFER_HIGHWATER)
     {
         uart_block_sender();
     }
 #endif   
 }
 
-void putch(char c)
+#if TX_BUFFER_SIZE > 0
+static bit uart_tx_buffer_full(void)
+{
+    return (unsigned char) (idxTxWrite - idxTxRead) >= TX_BUFFER_SIZE;
+}
+#endif
+
+//
+//  Send c if there's room for it, without waiting; returns 0 (and counts the
+//  byte as dropped) if there isn't.
+//
+bit uart_try_putch(char c)
 {
 #if TX_BUFFER_SIZE > 0
-    if (idxTxRead == idxTxWrite && TXIF)
+    if (idxTxRead == idxTxWrite && TXIF && ! TXIE && ! uart_is_tx_held())
     {
         TXREG = c;
-        return;
+        return 1;
+    }
+    
+    if (uart_tx_buffer_full())
+    {
+        cTxDropped++;
+        return 0;
     }
     
-    achTxBuffer[idxTxWrite++] = c;
-    if (idxTxWrite == TX_BUFFER_SIZE)
-        idxTxWrite = 0;
+    achTxBuffer[idxTxWrite & TX_BUFFER_MASK] = c;
+    idxTxWrite++;
     
     TXIE = 1;
+    return 1;
 #else
-    while (! TXIF)
-        ;
+    if (! TXIF)
+        return 0;
     
     TXREG = c;
+    return 1;
+#endif
+}
+
+//
+//  How long the most recently timed byte spent in the receive buffer.
+//
+unsigned int uart_get_rx_latency_ms(void)
+{
+#if RX_BUFFER_SIZE > 0
+    return cmsRxLatency;
+#else
+    return 0;
+#endif
+}
+
+unsigned int uart_get_tx_dropped(void)
+{
+#if TX_BUFFER_SIZE > 0
+    return cTxDropped;
+#else
+    return 0;
+#endif
+}
+
+//
+//  Send c, waiting for room if need be; the keyboard scan data is kept up
+//  with meanwhile, so that a slow (or XOFFed) host can't make us miss keys.
+//
+void putch(char c)
+{
+#if TX_BUFFER_SIZE > 0
+    while (uart_tx_buffer_full())
+#else
+    while (! TXIF)
+#endif
+    {
+        keyboard_update();
+        timers_idle();
+    }
+    
+    uart_try_putch(c);
+}
+
+//
+//  Look at a received byte without removing it from the buffer; idx counts
+//  from the next byte uart_get_rx_byte() would return, and 0 comes back for
+//  bytes that haven't arrived yet.
+//
+char uart_peek_rx_byte(unsigned char idx)
+{
+#if RX_BUFFER_SIZE > 0
+    if (idx >= uart_rx_buffer_used())
+        return 0;
+    
+    return achRxBuffer[(unsigned char) (idxRxRead + idx) & RX_BUFFER_MASK];
+#else
+    return 0;
 #endif
 }
 
@@ -122,12 +488,17 @@ char uart_get_rx_byte(void)
     if (idxRxRead == idxRxWrite)
         return 0;
     
-    char ch = achRxBuffer[idxRxRead++];
+    char ch = achRxBuffer[idxRxRead & RX_BUFFER_MASK];
+    
+    if (bRxTiming && idxRxRead == idxRxTimed)
+    {
+        cmsRxLatency = (uint16_t) timers_get_ms() - msRxTimed;
+        bRxTiming    = 0;
+    }
     
-    if (idxRxRead == RX_BUFFER_SIZE)
-        idxRxRead = 0;
+    idxRxRead++;
     
-    if (uart_rx_buffer_remaining() > RX_BUFFER_LOWWATER)
+    if (bSenderBlocked && uart_rx_buffer_used() <= RX_BUFFER_LOWWATER)
     {
         uart_unblock_sender();
     }
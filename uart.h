@@ -16,8 +16,19 @@ extern "C" {
     extern void uart_tx_isr(void);
     extern void uart_rx_isr(void);
     extern char uart_get_rx_byte(void);
+    extern char uart_peek_rx_byte(unsigned char idx);
     extern void uart_block_sender(void);
     extern void uart_unblock_sender(void);
+    extern bit  uart_hold_sender(void);
+    extern void uart_release_sender(void);
+    extern void uart_toggle_xonxoff(void);
+    extern void uart_toggle_dsr_flow(void);
+    extern void uart_cycle_baud(void);
+    extern void uart_start_autobaud(void);
+    extern bit uart_try_putch(char c);
+    extern unsigned int uart_get_tx_dropped(void);
+    extern unsigned int uart_get_rx_latency_ms(void);
+    extern void uart_update(void);
 
 
 #ifdef	__cplusplus